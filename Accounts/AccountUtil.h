@@ -28,14 +28,26 @@
 #import <UIKit/UIKit.h>
 #import "zkSforce.h"
 #import <MapKit/MapKit.h>
+#import "ConcurrentCache.h"
+#import "LayoutPlan.h"
 
 @interface AccountUtil : NSObject {
-    NSMutableDictionary *describeCache;
-    NSMutableDictionary *layoutCache;
-    NSMutableDictionary *geoLocationCache;
-    NSMutableDictionary *userPhotoCache;
-    NSUInteger *activityCount;
-    NSMutableDictionary *globalDescribeObjects;
+    // These are all read from background queues as well as the main thread
+    ConcurrentCache *describeCache;
+    ConcurrentCache *layoutCache;
+    ConcurrentCache *geoLocationCache;
+    ConcurrentCache *userPhotoCache;
+    ConcurrentCache *globalDescribeObjects;
+    volatile int32_t activityCount;
+    NSMutableSet *revalidatedMetadata;
+    
+    // Indexes over the caches above, kept up to date as they're filled
+    ConcurrentCache *keyPrefixIndex;        // key prefix -> sObject
+    ConcurrentCache *layoutIndex;           // layout Id -> ZKDescribeLayout
+    ConcurrentCache *layoutsObjectIndex;    // layout Id -> sObject
+    ConcurrentCache *recordTypesObjectIndex; // record type Id -> sObject
+    
+    ConcurrentCache *layoutPlanCache;       // layout Id -> LayoutPlan
 }
 
 + (AccountUtil *)sharedAccountUtil;
@@ -75,6 +87,12 @@
 + (BOOL) isConnected;
 
 - (void) emptyCaches:(BOOL)emptyAll;
+- (void) openMetadataCache;
+- (void) logCacheStatistics;
+
+// for measuring cold start, the app delegate marks the launch, and the first account laid out after it logs how long that took
++ (void) markAppLaunched;
+- (void) logFirstAccountRender;
 - (NSArray *) coordinatesFromCache:(NSString *)accountId;
 - (void) addCoordinatesToCache:(CLLocationCoordinate2D)coordinates accountId:(NSString *)accountId;
 - (UIImage *) userPhotoFromCache:(NSString *)photoURL;
@@ -113,6 +131,8 @@
 - (void) describeGlobal:(void (^)(void))completeBlock;
 - (ZKDescribeGlobalSObject *) describeGlobalsObject:(NSString *)sObject;
 - (void) describesObject:(NSString *)sObject completeBlock:(void (^)(ZKDescribeSObject * sObjectDescribe))completeBlock;
+- (void) describesObjects:(NSArray *)sObjects completeBlock:(void (^)(void))completeBlock;
+- (void) prefetchDescribesForsObject:(NSString *)sObject;
 - (ZKDescribeField *) describeForField:(NSString *)field sObject:(NSString *)sObject;
 - (NSString *) sObjectFromLayoutId:(NSString *)layoutId;
 - (NSString *) sObjectFromRecordTypeId:(NSString *)recordTypeId;
@@ -126,6 +146,14 @@
 - (ZKDescribeLayout *) layoutForRecord:(NSDictionary *)record;
 - (ZKDescribeLayout *) layoutWithLayoutId:(NSString *)layoutId;
 - (NSArray *) fieldListForLayoutId:(NSString *)layoutId;
+- (LayoutPlan *) layoutPlanForLayoutId:(NSString *)layoutId;
+- (void) invalidateLayoutPlans;
+
+// Reads every field on a layout for one record. Layouts with more fields than fit in one query are
+// read with several, all at once, and put back together into one record. The record is nil if it wasn't found.
+- (ZKCancellationToken *) loadRecordWithId:(NSString *)recordId layoutId:(NSString *)layoutId sObject:(NSString *)sObject 
+                                 failBlock:(zkFailWithExceptionBlock)failBlock 
+                             completeBlock:(void (^)(ZKSObject *record))completeBlock;
 
 // Running user info
 - (void) loadUserInfo;
@@ -37,6 +37,7 @@
 #import "FieldPopoverButton.h"
 #import "RootViewController.h"
 #import <QuartzCore/QuartzCore.h>
+#include <libkern/OSAtomic.h>
 
 @implementation AccountUtil
 
@@ -45,6 +46,10 @@ SYNTHESIZE_SINGLETON_FOR_CLASS(AccountUtil);
 #define LOADVIEWBOXSIZE 100
 #define LOADINGVIEWTAG -11
 
+// How many geolocations and user photos we hold onto before the oldest are dropped
+#define GEOLOCATIONCACHELIMIT 500
+#define USERPHOTOCACHELIMIT 100
+
 // Keys for things being stored in the Keychain
 static NSString *NextAccountID = @"NextAccountId";
 
@@ -54,8 +59,29 @@ static NSString *FollowedAccounts = @"FollowedAccounts";
 
 BOOL chatterEnabled = NO;
 
+// when the app launched, cleared once the first account has been rendered
+static CFAbsoluteTime appLaunchedAt = 0;
+
 @synthesize client;
 
+- (id) init {
+    if(( self = [super init] )) {
+        describeCache = [[ConcurrentCache alloc] initWithName:@"describes" countLimit:0];
+        layoutCache = [[ConcurrentCache alloc] initWithName:@"layouts" countLimit:0];
+        globalDescribeObjects = [[ConcurrentCache alloc] initWithName:@"global describe" countLimit:0];
+        geoLocationCache = [[ConcurrentCache alloc] initWithName:@"geolocations" countLimit:GEOLOCATIONCACHELIMIT];
+        userPhotoCache = [[ConcurrentCache alloc] initWithName:@"user photos" countLimit:USERPHOTOCACHELIMIT];
+        
+        keyPrefixIndex = [[ConcurrentCache alloc] initWithName:@"key prefixes" countLimit:0];
+        layoutIndex = [[ConcurrentCache alloc] initWithName:@"layout ids" countLimit:0];
+        layoutsObjectIndex = [[ConcurrentCache alloc] initWithName:@"layout sObjects" countLimit:0];
+        recordTypesObjectIndex = [[ConcurrentCache alloc] initWithName:@"record type sObjects" countLimit:0];
+        layoutPlanCache = [[ConcurrentCache alloc] initWithName:@"layout plans" countLimit:0];
+    }
+    
+    return self;
+}
+
 + (NSString *) appFullName {
     return [[NSBundle mainBundle] objectForInfoDictionaryKey:@"CFBundleDisplayName"];
 }
@@ -66,9 +92,34 @@ BOOL chatterEnabled = NO;
 
 #pragma mark - caching functions
 
+- (void) logCacheStatistics {
+    for( ConcurrentCache *cache in [NSArray arrayWithObjects:describeCache, layoutCache, globalDescribeObjects,
+                                    geoLocationCache, userPhotoCache, keyPrefixIndex, layoutIndex,
+                                    layoutsObjectIndex, recordTypesObjectIndex, layoutPlanCache, nil] )
+        NSLog(@"CACHE %@", cache);
+}
+
++ (void) markAppLaunched {
+    appLaunchedAt = CFAbsoluteTimeGetCurrent();
+}
+
+- (void) logFirstAccountRender {
+    if( appLaunchedAt == 0 )
+        return;
+    
+    NSLog(@"FIRST ACCOUNT RENDER %.3fs after launch (metadata cache %@)", CFAbsoluteTimeGetCurrent() - appLaunchedAt,
+          ( [client metadataCache] ? @"on" : @"off" ));
+    appLaunchedAt = 0;
+}
+
 - (void) emptyCaches:(BOOL)emptyAll {
+    [self logCacheStatistics];
+    
     [SimpleKeychain delete:FollowedAccounts];
-    activityCount = 0;
+    
+    while( !OSAtomicCompareAndSwap32Barrier(activityCount, 0, &activityCount) )
+        ;
+    
     [geoLocationCache removeAllObjects];
     [userPhotoCache removeAllObjects];
     
@@ -76,29 +127,94 @@ BOOL chatterEnabled = NO;
         [globalDescribeObjects removeAllObjects];
         [layoutCache removeAllObjects];
         [describeCache removeAllObjects];
+        [revalidatedMetadata removeAllObjects];
+        [keyPrefixIndex removeAllObjects];
+        [layoutIndex removeAllObjects];
+        [layoutsObjectIndex removeAllObjects];
+        [recordTypesObjectIndex removeAllObjects];
+        [self invalidateLayoutPlans];
+        
+        // Only a logout empties everything, so take the on-disk describes with it
+        [[client metadataCache] removeAllEntries];
+        [client setMetadataCache:nil];
     }
 }
 
-- (void) addCoordinatesToCache:(CLLocationCoordinate2D)coordinates accountId:(NSString *)accountId {
-    if( !geoLocationCache )
-        geoLocationCache = [[NSMutableDictionary dictionary] retain];
+// Describes and layouts are kept on disk for each org and user, so the next launch can
+// render from them straight away and refresh them from the network in the background.
+- (void) openMetadataCache {
+    ZKUserInfo *info = [client currentUserInfo];
+    
+    if( !info ) {
+        [client setMetadataCache:nil];
+        return;
+    }
+    
+    NSString *path = [ZKMetadataCache defaultPathForOrgId:[info organizationId] userId:[info userId]];
+    ZKMetadataCache *cache = [[ZKMetadataCache alloc] initWithPath:path apiVersion:[client preferedApiVersion]];
+    
+    [client setMetadataCache:cache];
+    [cache release];
+    
+    [revalidatedMetadata removeAllObjects];
+}
+
+// Called on the main thread after we've answered from the metadata cache. Makes the real call
+// in the background, at most once per login for each key, so the cache on disk and in memory
+// catches up with any changes to the org. updateBlock is called on the main thread.
+- (void) revalidateMetadataForKey:(NSString *)key fetchBlock:(id (^)(void))fetchBlock updateBlock:(void (^)(id result))updateBlock {
+    [self revalidateMetadataForKeys:[NSArray arrayWithObject:key] fetchBlock:fetchBlock updateBlock:updateBlock];
+}
+
+// As above, for a single call that refreshes several keys at once. Nothing is fetched if every key
+// has already been revalidated.
+- (void) revalidateMetadataForKeys:(NSArray *)keys fetchBlock:(id (^)(void))fetchBlock updateBlock:(void (^)(id result))updateBlock {
+    if( !revalidatedMetadata )
+        revalidatedMetadata = [[NSMutableSet alloc] init];
+    
+    if( [[NSSet setWithArray:keys] isSubsetOfSet:revalidatedMetadata] )
+        return;
+    
+    [revalidatedMetadata addObjectsFromArray:keys];
+    NSString *key = [keys componentsJoinedByString:@", "];
+    
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW,0), ^(void) {
+        id result = nil;
         
+        @try {
+            result = fetchBlock();
+        } @catch( NSException *e ) {
+            // We've already shown what was cached, so just try again next time
+            NSLog(@"REVALIDATE %@ FAILED: %@", key, [e reason]);
+            
+            dispatch_async(dispatch_get_main_queue(), ^(void) {
+                for( NSString *k in keys )
+                    [revalidatedMetadata removeObject:k];
+            });
+            
+            return;
+        }
+        
+        if( !result )
+            return;
+        
+        dispatch_async(dispatch_get_main_queue(), ^(void) {
+            updateBlock(result);
+        });
+    });
+}
+
+- (void) addCoordinatesToCache:(CLLocationCoordinate2D)coordinates accountId:(NSString *)accountId {
     [geoLocationCache setObject:[NSArray arrayWithObjects:[NSNumber numberWithDouble:coordinates.latitude], [NSNumber numberWithDouble:coordinates.longitude], nil]
                          forKey:accountId];        
 }
 
 - (NSArray *)coordinatesFromCache:(NSString *)accountId {
-    if( !geoLocationCache )
-        geoLocationCache = [[NSMutableDictionary dictionary] retain];
-    
     // nil or an array
     return [geoLocationCache objectForKey:accountId];
 }
 
 - (void) addUserPhotoToCache:(UIImage *)photo forURL:(NSString *)photoURL {
-    if( !userPhotoCache )
-        userPhotoCache = [[NSMutableDictionary dictionary] retain];
-    
     if( !photo )
         return;
         
@@ -106,9 +222,6 @@ BOOL chatterEnabled = NO;
 }
 
 - (UIImage *) userPhotoFromCache:(NSString *)photoURL {
-    if( !userPhotoCache )
-        userPhotoCache = [[NSMutableDictionary dictionary] retain];
-    
     return [userPhotoCache objectForKey:photoURL];
 }
 
@@ -454,53 +567,49 @@ BOOL chatterEnabled = NO;
     if( !layout )
         return [view autorelease];
     
-    NSString *sObjectName = [self sObjectFromRecordId:[sObject id]];
+    LayoutPlan *plan = [self layoutPlanForLayoutId:[layout Id]];
+    const LayoutOp *ops = [plan ops];
+    BOOL useHeading = NO;
+    int sectionFields = 0;
+    float rowHeight = 0, curX = 0;
     
-    // 1. Loop through all sections in this page layout
-    for( ZKDescribeLayoutSection *section in [layout detailLayoutSections] ) {
-        if( [section useHeading] ) {
-            UIView *sectionHeader = [AccountUtil createViewForSection:[section heading]];
-            sectionHeader.tag = sectionCount;
-            
-            [sectionHeader setFrame:CGRectMake(0, curY, sectionHeader.frame.size.width, sectionHeader.frame.size.height)];
-            
-            curY += sectionHeader.frame.size.height + SECTIONSPACING;
-            
-            [view addSubview:sectionHeader];   
-        }
-        
-        int sectionFields = 0;
+    // Walk the compiled layout: sections, then rows within each section, then the fields on each row
+    for( NSUInteger i = 0; i < [plan opCount]; i++ ) {
+        const LayoutOp *op = &ops[i];
         
-        // 2. Loop through all rows within this section
-        for( ZKDescribeLayoutRow *dlr in [section layoutRows]) {
-            float rowHeight = 0, curX = 0;
-            
-            // 3. Each individual item on this row
-            for ( ZKDescribeLayoutItem *item in [dlr layoutItems] ) {                
-                if( [item placeholder] || [[item layoutComponents] count] == 0 )
-                    continue;
-                
-                ZKDescribeLayoutComponent *f = [[item layoutComponents] objectAtIndex:0];
-                
-                if( ![[f typeName] isEqualToString:@"Field"] )
-                    continue;
-                
-                NSString *field = [[f value] isEqualToString:@"Salutation"] ? @"Name" : [f value];
+        switch( op->type ) {
+            case LayoutOpSectionStart:
+                useHeading = op->useHeading;
+                sectionFields = 0;
                 
-                // Position this field within our scrollview, alternating left and right sides
-                ZKDescribeField *desc = [[AccountUtil sharedAccountUtil] describeForField:field sObject:sObjectName];
-                                    
-                if( !showEmptyFields && [AccountUtil isEmpty:[sObject fieldValue:field]] )
+                if( useHeading ) {
+                    UIView *sectionHeader = [AccountUtil createViewForSection:op->text];
+                    sectionHeader.tag = sectionCount;
+                    
+                    [sectionHeader setFrame:CGRectMake(0, curY, sectionHeader.frame.size.width, sectionHeader.frame.size.height)];
+                    
+                    curY += sectionHeader.frame.size.height + SECTIONSPACING;
+                    
+                    [view addSubview:sectionHeader];   
+                }
+                break;
+            case LayoutOpRowStart:
+                rowHeight = 0;
+                curX = 0;
+                break;
+            case LayoutOpField: {
+                if( !showEmptyFields && [AccountUtil isEmpty:[sObject fieldValue:op->field]] )
                     continue;
                 
                 // If this is a formula field with a hyperlink or an image, skip for now.
-                if( [desc calculated] && ![AccountUtil isEmpty:[sObject fieldValue:field]] &&
-                   ( [[sObject fieldValue:[f value]] rangeOfString:@"<img src"].location != NSNotFound || 
-                    [[sObject fieldValue:[f value]] rangeOfString:@"<a href"].location != NSNotFound ) )
+                if( op->calculated && ![AccountUtil isEmpty:[sObject fieldValue:op->field]] &&
+                   ( [[sObject fieldValue:op->valueField] rangeOfString:@"<img src"].location != NSNotFound || 
+                    [[sObject fieldValue:op->valueField] rangeOfString:@"<a href"].location != NSNotFound ) )
                     continue;
                 
-                UIView *fieldView = [self createViewForField:field
-                                                   withLabel:[item label] 
+                // Position this field within our scrollview, alternating left and right sides
+                UIView *fieldView = [self createViewForField:op->field
+                                                   withLabel:op->text 
                                               withDictionary:[sObject fields]
                                                   withTarget:target];
                 
@@ -518,24 +627,27 @@ BOOL chatterEnabled = NO;
                 [view addSubview:fieldView];                
                 
                 fieldCount++;
+                break;
             }
-            
-            if( !singleColumn )
-                curY += rowHeight + FIELDSPACING;
-        }
-        
-        // This is a little janky; we remove the section header view retroactively if there were no fields in it
-        if( [section useHeading] && sectionFields == 0 ) {
-            UIView *sectionView = [[view subviews] lastObject];
-            curY -= sectionView.frame.size.height + SECTIONSPACING;
-            [sectionView removeFromSuperview];
-            
-            continue;
+            case LayoutOpRowEnd:
+                if( !singleColumn )
+                    curY += rowHeight + FIELDSPACING;
+                break;
+            case LayoutOpSectionEnd:
+                // This is a little janky; we remove the section header view retroactively if there were no fields in it
+                if( useHeading && sectionFields == 0 ) {
+                    UIView *sectionView = [[view subviews] lastObject];
+                    curY -= sectionView.frame.size.height + SECTIONSPACING;
+                    [sectionView removeFromSuperview];
+                    
+                    continue;
+                }
+                
+                sectionCount++;
+                
+                curY += SECTIONSPACING;
+                break;
         }
-        
-        sectionCount++;
-        
-        curY += SECTIONSPACING;
     }
     
     if( fieldCount == 0 ) {        
@@ -587,28 +699,55 @@ BOOL chatterEnabled = NO;
 }
 
 - (void) describeGlobal:(void (^)(void))completeBlock {
-    if( !globalDescribeObjects )
-        globalDescribeObjects = [[NSMutableDictionary dictionary] retain];
-    else
-        [globalDescribeObjects removeAllObjects];
-    
     NSLog(@"DESCRIBE GLOBAL SOBJECTS");
     
+    void (^storeResults)(NSArray *) = ^(NSArray *describeResults) {
+        // Both are built off to the side and swapped in whole, as they're read from background threads,
+        // which mustn't catch them empty part way through a refresh
+        NSMutableDictionary *objects = [NSMutableDictionary dictionaryWithCapacity:[describeResults count]];
+        NSMutableDictionary *prefixes = [NSMutableDictionary dictionaryWithCapacity:[describeResults count]];
+        
+        for( ZKDescribeGlobalSObject *ob in describeResults ) {
+            [objects setObject:ob forKey:[ob name]];
+            
+            // Only the sObject we could actually load a record from is indexed for its prefix
+            if( [ob keyPrefix] && [ob queryable] && [ob retrieveable] && ![ob deprecatedAndHidden] &&
+                ![prefixes objectForKey:[ob keyPrefix]] )
+                [prefixes setObject:[ob name] forKey:[ob keyPrefix]];
+        }
+        
+        [globalDescribeObjects replaceAllObjectsWithDictionary:objects];
+        [keyPrefixIndex replaceAllObjectsWithDictionary:prefixes];
+        [self invalidateLayoutPlans];
+    };
+    
     dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,0), ^(void) {   
-        NSArray *describeResults = nil;
+        ZKSforceClient *c = [[AccountUtil sharedAccountUtil] client];
+        NSArray *describeResults = [c cachedDescribeGlobal];
+        
+        if( [describeResults count] > 0 ) {
+            dispatch_async(dispatch_get_main_queue(), ^(void) {
+                storeResults(describeResults);
+                completeBlock();
+                
+                [self revalidateMetadataForKey:@"describeGlobal"
+                                    fetchBlock:^id(void) { return [c describeGlobal]; }
+                                   updateBlock:^(id result) { storeResults(result); }];
+            });
+            
+            return;
+        }
         
         @try {
-            describeResults = [[[AccountUtil sharedAccountUtil] client] describeGlobal];
+            describeResults = [c describeGlobal];
         } @catch( NSException *e ) {
             [[AccountUtil sharedAccountUtil] receivedException:e];
-            
-            completeBlock();
+            describeResults = nil;
         }
         
         dispatch_async(dispatch_get_main_queue(), ^(void) {         
             if( describeResults && [describeResults count] > 0 )            
-                for( ZKDescribeGlobalSObject *ob in describeResults )
-                    [globalDescribeObjects setObject:ob forKey:[ob name]];
+                storeResults(describeResults);
                 
             completeBlock();
         });
@@ -836,9 +975,36 @@ BOOL chatterEnabled = NO;
     return nil;
 }
 
+// All writes to the layout cache go through here, so the layout and record type indexes stay in step with it.
+- (void) cacheLayoutResult:(ZKDescribeLayoutResult *)result forsObject:(NSString *)sObject {
+    // Drop whatever the previous describe of this sObject had indexed
+    ZKDescribeLayoutResult *old = [layoutCache objectForKey:sObject];
+    
+    for( ZKDescribeLayout *layout in [old layouts] )
+        if( [layout Id] ) {
+            [layoutIndex removeObjectForKey:[layout Id]];
+            [layoutsObjectIndex removeObjectForKey:[layout Id]];
+        }
+    
+    for( ZKRecordTypeMapping *mapping in [old recordTypeMappings] )
+        if( [mapping recordTypeId] )
+            [recordTypesObjectIndex removeObjectForKey:[mapping recordTypeId]];
+    
+    [layoutCache setObject:result forKey:sObject];
+    [self invalidateLayoutPlans];
+    
+    for( ZKDescribeLayout *layout in [result layouts] )
+        if( [layout Id] ) {
+            [layoutIndex setObject:layout forKey:[layout Id]];
+            [layoutsObjectIndex setObject:sObject forKey:[layout Id]];
+        }
+    
+    for( ZKRecordTypeMapping *mapping in [result recordTypeMappings] )
+        if( [mapping recordTypeId] && ![recordTypesObjectIndex objectForKey:[mapping recordTypeId]] )
+            [recordTypesObjectIndex setObject:sObject forKey:[mapping recordTypeId]];
+}
+
 - (void) describeLayoutForsObject:(NSString *)sObject completeBlock:(void (^)(ZKDescribeLayoutResult * layoutDescribe))completeBlock {
-    if( !layoutCache )
-        layoutCache = [[NSMutableDictionary dictionary] retain];
     
     if( !sObject )
         return;
@@ -853,10 +1019,28 @@ BOOL chatterEnabled = NO;
     NSLog(@"DESCRIBE LAYOUT: %@", sObject);
     
     dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,0), ^(void) {   
-        ZKDescribeLayoutResult *result = nil;
+        ZKSforceClient *c = [[AccountUtil sharedAccountUtil] client];
+        ZKDescribeLayoutResult *result = [c cachedDescribeLayout:sObject];
+        
+        if( result ) {
+            dispatch_async(dispatch_get_main_queue(), ^(void) {
+                [self endNetworkAction];
+                
+                if( ![layoutCache objectForKey:sObject] )
+                    [self cacheLayoutResult:result forsObject:sObject];
+                
+                completeBlock(result);
+                
+                [self revalidateMetadataForKey:[@"describeLayout:" stringByAppendingString:sObject]
+                                    fetchBlock:^id(void) { return [c describeLayout:sObject recordTypeIds:nil]; }
+                                   updateBlock:^(id fresh) { [self cacheLayoutResult:fresh forsObject:sObject]; }];
+            });
+            
+            return;
+        }
         
         @try {
-            result = [[[AccountUtil sharedAccountUtil] client] describeLayout:sObject recordTypeIds:nil];
+            result = [c describeLayout:sObject recordTypeIds:nil];
         } @catch( NSException *e ) {
             [[AccountUtil sharedAccountUtil] receivedException:e];
             [self endNetworkAction];
@@ -870,7 +1054,7 @@ BOOL chatterEnabled = NO;
             if( !result )
                 return;
             
-            [layoutCache setObject:result forKey:sObject];
+            [self cacheLayoutResult:result forsObject:sObject];
             
             completeBlock(result);
         });
@@ -883,34 +1067,21 @@ BOOL chatterEnabled = NO;
     if( !recordId || [recordId length] < 15 )
         return nil; // local record
     
-    NSString *prefix = [recordId substringToIndex:3];
-    
-    for( NSString *sObject in [globalDescribeObjects allKeys] ) {
-        ZKDescribeGlobalSObject *ob = [globalDescribeObjects objectForKey:sObject];
-        
-        if( ob && [ob queryable] && [ob retrieveable] && ![ob deprecatedAndHidden] && [[ob keyPrefix] isEqualToString:prefix] )
-            return sObject;
-    }
-    
-    return nil;
+    return [keyPrefixIndex objectForKey:[recordId substringToIndex:3]];
 }
 
 - (NSString *) sObjectFromLayoutId:(NSString *)layoutId {
-    for( NSString *sObject in [layoutCache allKeys] )
-        for( ZKDescribeLayout *layout in [[layoutCache objectForKey:sObject] layouts] )
-            if( [[layout Id] isEqualToString:layoutId] )
-                return sObject;
-
-    return nil;
+    if( !layoutId )
+        return nil;
+    
+    return [layoutsObjectIndex objectForKey:layoutId];
 }
 
 - (NSString *) sObjectFromRecordTypeId:(NSString *)recordTypeId {
-    for( NSString *sObject in [layoutCache allKeys] )
-        for( ZKRecordTypeMapping *mapping in [[layoutCache objectForKey:sObject] recordTypeMappings] )
-            if( [[mapping recordTypeId] isEqualToString:recordTypeId] )
-                return sObject;
+    if( !recordTypeId )
+        return nil;
     
-    return nil;
+    return [recordTypesObjectIndex objectForKey:recordTypeId];
 }
 
 - (ZKDescribeLayout *) layoutForRecord:(NSDictionary *)record {
@@ -945,15 +1116,10 @@ BOOL chatterEnabled = NO;
 }
 
 - (ZKDescribeLayout *) layoutWithLayoutId:(NSString *)layoutId {
-    if( !layoutCache || [layoutCache count] == 0 || !layoutId )
+    if( !layoutId )
         return nil;
     
-    for( ZKDescribeLayoutResult *result in [layoutCache allValues] )
-        for( ZKDescribeLayout *layout in [result layouts] )
-            if( [[layout Id] isEqualToString:layoutId] )
-                return layout;
-    
-    return nil;
+    return [layoutIndex objectForKey:layoutId];
 }
 
 - (NSString *)nameFieldForsObject:(NSString *)sObject {
@@ -990,19 +1156,88 @@ BOOL chatterEnabled = NO;
 
 // Returns a list of field names that appear in a given record layout, for use in constructing a query
 - (NSArray *)fieldListForLayoutId:(NSString *)layoutId {
+    LayoutPlan *plan = [self layoutPlanForLayoutId:layoutId];
+    
+    if( !plan )
+        return [NSArray arrayWithObject:@"id"];
+    
+    return [plan fieldList];
+}
+
+// Layouts are compiled the first time they're used, and kept until any describe or layout is refreshed,
+// since the field list depends on the describes of the sObject and everything it looks up to.
+- (LayoutPlan *) layoutPlanForLayoutId:(NSString *)layoutId {
+    if( !layoutId )
+        return nil;
+    
+    LayoutPlan *plan = [layoutPlanCache objectForKey:layoutId];
+    
+    if( plan )
+        return plan;
+    
+    plan = [self compileLayoutPlanForLayoutId:layoutId];
+    
+    if( plan )
+        [layoutPlanCache setObject:plan forKey:layoutId];
+    
+    return plan;
+}
+
+- (void) invalidateLayoutPlans {
+    [layoutPlanCache removeAllObjects];
+}
+
+- (ZKCancellationToken *) loadRecordWithId:(NSString *)recordId layoutId:(NSString *)layoutId sObject:(NSString *)sObject 
+                                 failBlock:(zkFailWithExceptionBlock)failBlock 
+                             completeBlock:(void (^)(ZKSObject *record))completeBlock {
+    LayoutPlan *plan = [self layoutPlanForLayoutId:layoutId];
+    NSArray *queries = nil;
+    
+    if( plan )
+        queries = [plan queriesForRecordId:recordId];
+    else
+        queries = [NSArray arrayWithObject:[NSString stringWithFormat:@"select Id from %@ where id='%@' limit 1", sObject, recordId]];
+    
+    for( NSString *query in queries )
+        NSLog(@"SOQL %@", query);
+    
+    return [client performQueries:queries failBlock:failBlock completeBlock:^(NSArray *results) {
+        ZKSObject *record = nil;
+        
+        for( ZKQueryResult *qr in results ) {
+            if( [[qr records] count] == 0 ) {
+                completeBlock(nil);
+                return;
+            }
+            
+            if( !record )
+                record = [[[[qr records] objectAtIndex:0] copy] autorelease];
+            else
+                [record addFieldsFromSObject:[[qr records] objectAtIndex:0]];
+        }
+        
+        completeBlock(record);
+    }];
+}
+
+- (LayoutPlan *) compileLayoutPlanForLayoutId:(NSString *)layoutId {
     NSMutableArray *ret = [NSMutableArray arrayWithObject:@"id"];
     
     ZKDescribeLayout *layout = [self layoutWithLayoutId:layoutId];
     NSString *sObject = [self sObjectFromLayoutId:layoutId];
     
     if( !layout ) 
-        return ret;
+        return nil;
+    
+    LayoutPlan *plan = [[[LayoutPlan alloc] initWithLayoutId:layoutId sObject:sObject] autorelease];
         
     // 1. Loop through all sections in this page layout
     for( ZKDescribeLayoutSection *section in [layout detailLayoutSections] ) {
+        [plan addSectionStart:[section heading] useHeading:[section useHeading]];
         
         // 2. Loop through all rows within this section
         for( ZKDescribeLayoutRow *dlr in [section layoutRows]) {
+            [plan addOp:LayoutOpRowStart];
             
             // 3. Each individual item on this row
             for ( ZKDescribeLayoutItem *item in [dlr layoutItems] ) {
@@ -1017,8 +1252,18 @@ BOOL chatterEnabled = NO;
                     
                     NSString *fname = [dlc value];
                     
+                    // Only the first component of an item is rendered
+                    if( dlc == [[item layoutComponents] objectAtIndex:0] ) {
+                        NSString *field = [fname isEqualToString:@"Salutation"] ? @"Name" : fname;
+                        
+                        [plan addField:field
+                            valueField:fname
+                                 label:[item label]
+                            calculated:[[self describeForField:field sObject:sObject] calculated]];
+                    }
+                    
                     // If this field is a lookup relationship, we will attempt to get the name of the related object in addition to its ID
-                    ZKDescribeField *f = [self describeForField:fname sObject:[self sObjectFromLayoutId:layoutId]];
+                    ZKDescribeField *f = [self describeForField:fname sObject:sObject];
                     
                     if( [f relationshipName] && [[f type] isEqualToString:@"reference"] ) {
                         // Special handling for the 'What' and 'Who' fields on Task, which can refer to just about anything                        
@@ -1055,7 +1300,11 @@ BOOL chatterEnabled = NO;
                     [ret addObject:fname];
                 }     
             }
+            
+            [plan addOp:LayoutOpRowEnd];
         }
+        
+        [plan addOp:LayoutOpSectionEnd];
     }
     
     // Ensure that header fields are included in the query for accounts
@@ -1080,20 +1329,20 @@ BOOL chatterEnabled = NO;
     if( ![ret containsObject:[self nameFieldForsObject:sObject]] )
         [ret addObject:[self nameFieldForsObject:sObject]];
     
-    NSArray *allFields = [[NSSet setWithArray:ret] allObjects];
-    [ret removeAllObjects];
-    int counter = 0;
+    // SOQL won't select the same field twice, in any case. Nothing is dropped for length any more,
+    // the plan splits the fields over as many queries as it takes.
+    NSMutableArray *allFields = [NSMutableArray arrayWithCapacity:[ret count]];
+    NSMutableSet *seen = [NSMutableSet setWithCapacity:[ret count]];
     
-    for( int x = 0; x < [allFields count]; x++ ) {
-        if( counter >= SOQLMAXLENGTH - 50 )
-            break;
-        
-        [ret addObject:[allFields objectAtIndex:x]];
-        
-        counter += [[allFields objectAtIndex:x] length] + ( counter > 0 ? 1 : 0 );
-    }
+    for( NSString *field in ret )
+        if( ![seen containsObject:[field lowercaseString]] ) {
+            [seen addObject:[field lowercaseString]];
+            [allFields addObject:field];
+        }
     
-    return ret;
+    [plan setFieldList:allFields];
+    
+    return plan;
 }
 
 - (ZKDescribeSObject *) describeSObjectFromCache:(NSString *)sObject {
@@ -1103,9 +1352,13 @@ BOOL chatterEnabled = NO;
     return [describeCache objectForKey:sObject];
 }
 
+// All writes to the describe cache go through here, so compiled layouts that used the old describe are dropped.
+- (void) cacheDescribe:(ZKDescribeSObject *)describe forsObject:(NSString *)sObject {
+    [describeCache setObject:describe forKey:sObject];
+    [self invalidateLayoutPlans];
+}
+
 - (void) describesObject:(NSString *)sObject completeBlock:(void (^)(ZKDescribeSObject *))completeBlock {
-    if( !describeCache )
-        describeCache = [[NSMutableDictionary dictionary] retain];
     
     if( !sObject )
         return;
@@ -1121,10 +1374,28 @@ BOOL chatterEnabled = NO;
     NSLog(@"DESCRIBE SOBJECT: %@", sObject);
     
     dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,0), ^(void) {   
-        ZKDescribeSObject *describe = nil;
+        ZKSforceClient *c = [[AccountUtil sharedAccountUtil] client];
+        ZKDescribeSObject *describe = [c cachedDescribeSObject:sObject];
+        
+        if( describe ) {
+            dispatch_async(dispatch_get_main_queue(), ^(void) {
+                [self endNetworkAction];
+                
+                if( ![describeCache objectForKey:sObject] )
+                    [self cacheDescribe:describe forsObject:sObject];
+                
+                completeBlock( describe );
+                
+                [self revalidateMetadataForKey:[@"describeSObject:" stringByAppendingString:sObject]
+                                    fetchBlock:^id(void) { return [c describeSObject:sObject]; }
+                                   updateBlock:^(id fresh) { [self cacheDescribe:fresh forsObject:sObject]; }];
+            });
+            
+            return;
+        }
         
         @try {
-            describe = [[[AccountUtil sharedAccountUtil] client] describeSObject:sObject];
+            describe = [c describeSObject:sObject];
         } @catch( NSException *e ) {
             [[AccountUtil sharedAccountUtil] receivedException:e];
             [self endNetworkAction];
@@ -1136,7 +1407,7 @@ BOOL chatterEnabled = NO;
             [self endNetworkAction];
             
             if( describe ) {         
-                [describeCache setObject:describe forKey:sObject];
+                [self cacheDescribe:describe forsObject:sObject];
                 completeBlock( describe );
             } else
                 completeBlock( nil );    
@@ -1146,6 +1417,115 @@ BOOL chatterEnabled = NO;
     return;
 }
 
+// Describes every sObject in the list that we don't already have. Whatever is in the metadata cache
+// is used first, and the rest are fetched together in batched describeSObjects calls, rather than
+// a round trip each.
+- (void) describesObjects:(NSArray *)sObjects completeBlock:(void (^)(void))completeBlock {
+    
+    NSMutableArray *needed = [NSMutableArray arrayWithCapacity:[sObjects count]];
+    
+    for( NSString *sObject in sObjects )
+        if( ![describeCache objectForKey:sObject] && ![needed containsObject:sObject] )
+            [needed addObject:sObject];
+    
+    if( [needed count] == 0 ) {
+        completeBlock();
+        return;
+    }
+    
+    [self startNetworkAction];
+    
+    NSLog(@"DESCRIBE SOBJECTS: %@", [needed componentsJoinedByString:@", "]);
+    
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,0), ^(void) {   
+        ZKSforceClient *c = [[AccountUtil sharedAccountUtil] client];
+        NSMutableDictionary *cached = [NSMutableDictionary dictionary];
+        NSMutableArray *missing = [NSMutableArray array];
+        NSArray *describes = nil;
+        
+        for( NSString *sObject in needed ) {
+            ZKDescribeSObject *describe = [c cachedDescribeSObject:sObject];
+            
+            if( describe )
+                [cached setObject:describe forKey:sObject];
+            else
+                [missing addObject:sObject];
+        }
+        
+        if( [missing count] > 0 ) {
+            @try {
+                describes = [c describeSObjects:missing];
+            } @catch( NSException *e ) {
+                [[AccountUtil sharedAccountUtil] receivedException:e];
+                describes = nil;
+            }
+        }
+        
+        dispatch_async(dispatch_get_main_queue(), ^(void) {         
+            [self endNetworkAction];
+            
+            for( NSString *sObject in cached )
+                if( ![describeCache objectForKey:sObject] )
+                    [self cacheDescribe:[cached objectForKey:sObject] forsObject:sObject];
+            
+            // describeSObjects returns them in the order they were asked for
+            if( [describes count] == [missing count] )
+                for( NSUInteger i = 0; i < [missing count]; i++ )
+                    [self cacheDescribe:[describes objectAtIndex:i] forsObject:[missing objectAtIndex:i]];
+            
+            completeBlock();
+            
+            NSMutableArray *stale = [NSMutableArray array];
+            NSMutableArray *keys = [NSMutableArray array];
+            
+            for( NSString *sObject in cached ) {
+                NSString *key = [@"describeSObject:" stringByAppendingString:sObject];
+                
+                if( ![revalidatedMetadata containsObject:key] ) {
+                    [stale addObject:sObject];
+                    [keys addObject:key];
+                }
+            }
+            
+            if( [stale count] > 0 )
+                [self revalidateMetadataForKeys:keys
+                                     fetchBlock:^id(void) { return [c describeSObjects:stale]; }
+                                    updateBlock:^(id fresh) {
+                                        if( [fresh count] == [stale count] )
+                                            for( NSUInteger i = 0; i < [stale count]; i++ )
+                                                [self cacheDescribe:[fresh objectAtIndex:i] forsObject:[stale objectAtIndex:i]];
+                                    }];
+        });
+    });
+}
+
+// Warms the describe cache for everything a record of this sObject can link to: the targets of its
+// lookup fields, and the sObjects in the related lists on its layouts. The sObject and its layouts
+// need to have been described already.
+- (void) prefetchDescribesForsObject:(NSString *)sObject {
+    NSMutableSet *related = [NSMutableSet setWithArray:[self relatedsObjectsOnsObject:sObject]];
+    
+    for( ZKDescribeLayout *layout in [[layoutCache objectForKey:sObject] layouts] )
+        for( ZKRelatedList *list in [layout relatedLists] ) {
+            // Activity related lists are shown as Tasks
+            if( [[list sobject] isEqualToString:@"OpenActivity"] || [[list sobject] isEqualToString:@"ActivityHistory"] )
+                [related addObject:@"Task"];
+            else if( [list sobject] )
+                [related addObject:[list sobject]];
+        }
+    
+    // Anything the global describe doesn't know about would fail the whole batch it's in
+    NSMutableArray *sObjects = [NSMutableArray arrayWithCapacity:[related count]];
+    
+    for( NSString *name in related )
+        if( [globalDescribeObjects count] == 0 || [globalDescribeObjects objectForKey:name] )
+            [sObjects addObject:name];
+    
+    [self describesObjects:sObjects completeBlock:^(void) {
+        NSLog(@"PREFETCHED DESCRIBES FOR %@", sObject);
+    }];
+}
+
 - (ZKDescribeField *) describeForField:(NSString *)field sObject:(NSString *)sObject {
     if( !describeCache )
         return nil;
@@ -1217,24 +1597,30 @@ BOOL chatterEnabled = NO;
 #pragma mark - network activity indicator management
 
 - (void) refreshNetworkIndicator {
-    [UIApplication sharedApplication].networkActivityIndicatorVisible = activityCount > 0;
+    BOOL visible = activityCount > 0;
+    
+    if( [NSThread isMainThread] )
+        [UIApplication sharedApplication].networkActivityIndicatorVisible = visible;
+    else
+        dispatch_async(dispatch_get_main_queue(), ^(void) {
+            [UIApplication sharedApplication].networkActivityIndicatorVisible = activityCount > 0;
+        });
 }
 
 - (void) startNetworkAction {
     // Start the network activity spinner
-    if( !activityCount )
-        activityCount = 0;
-    
-    activityCount++;
+    OSAtomicIncrement32Barrier(&activityCount);
 
     [self refreshNetworkIndicator];
 }
 
 - (void) endNetworkAction {
-    if( activityCount > 0 )
-        activityCount--;
-    else
-        activityCount = 0;
+    // Never drop below zero, even if an end sneaks in after emptyCaches reset the count
+    int32_t count;
+    
+    do {
+        count = activityCount;
+    } while( count > 0 && !OSAtomicCompareAndSwap32Barrier(count, count - 1, &activityCount) );
     
     [self refreshNetworkIndicator];
 }
@@ -1491,36 +1877,16 @@ BOOL chatterEnabled = NO;
     if( !date )
         date = [NSDate dateWithTimeIntervalSinceNow:0];
     
-    // 2011-01-24T17:34:14.000Z
-    
-    NSDateFormatter *dformatter = [[NSDateFormatter alloc] init];
-    [dformatter setLocale:[NSLocale currentLocale]];
-    [dformatter setDateFormat:@"yyyy'-'MM'-'dd'T'HH':'mm':'ss'.000Z'"];
-    
-    NSString *format = [dformatter stringFromDate:date];
-    [dformatter release];
-        
-    return format;
+    // 2011-01-24T17:34:14.000Z, always in GMT
+    return [ZKDateTime dateTimeStringFromDate:date];
 }
 
 + (NSDate *) dateFromSOQLDatetime:(NSString *)datetime {
     // 2011-01-24T17:34:14.000Z
-    NSDate *date;
-    
     if( !datetime )
         return [NSDate dateWithTimeIntervalSinceNow:0];
     
-    datetime = [datetime stringByReplacingOccurrencesOfString:@".000Z" withString:@""];
-    datetime = [datetime stringByReplacingOccurrencesOfString:@"T" withString:@" "];
-    
-    NSDateFormatter *dformatter = [[NSDateFormatter alloc] init];
-    [dformatter setLocale:[NSLocale currentLocale]];
-    [dformatter setDateFormat:@"yyyy-MM-dd HH:mm:ss"];
-    
-    date = [dformatter dateFromString:datetime];
-    [dformatter release];
-    
-    return date;
+    return [ZKDateTime dateFromDateTimeString:datetime];
 }
 
 + (NSArray *) filterRecords:(NSArray *)records dateField:(NSString *)dateField withDate:(NSDate *)date createdAfter:(BOOL)createdAfter {
@@ -1531,13 +1897,24 @@ BOOL chatterEnabled = NO;
         return records;
     
     NSMutableArray *ret = [NSMutableArray arrayWithCapacity:[records count]];
+    CFAbsoluteTime since = [date timeIntervalSinceReferenceDate];
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
     
+    // compare the raw times, rather than making a date for every record
     for( ZKSObject *record in records ) {
-        NSComparisonResult result = [date compare:[AccountUtil dateFromSOQLDatetime:[record fieldValue:dateField]]];
+        NSString *value = [record fieldValue:dateField];
+        CFAbsoluteTime recordTime = now;
+        
+        if( value ) {
+            const char *chars = [value UTF8String];
+            
+            if( !ZKParseDateTime( chars, strlen( chars ), &recordTime ) )
+                recordTime = now;
+        }
         
-        if( createdAfter && result == NSOrderedAscending )
+        if( createdAfter && since < recordTime )
             [ret addObject:record];
-        else if( !createdAfter && result == NSOrderedDescending )
+        else if( !createdAfter && since > recordTime )
             [ret addObject:record];
     }
     
@@ -64,6 +64,8 @@
 @synthesize window, detailViewController, splitViewController, rootViewController, splashScreen;
 
 - (BOOL)application:(UIApplication *)application didFinishLaunchingWithOptions:(NSDictionary *)launchOptions {
+    [AccountUtil markAppLaunched];
+    
     self.window.rootViewController = self.splitViewController;
     [self.window addSubview:splitViewController.view];
     
@@ -101,6 +103,10 @@
 - (void)applicationDidEnterBackground:(UIApplication *)application
 {
     NSLog(@"app did enter background");
+    
+    // describes are written to disk a little while after they arrive, make sure none are lost if we're killed in the background
+    [[[[AccountUtil sharedAccountUtil] client] metadataCache] save];
+    
     /*
      Use this method to release shared resources, save user data, invalidate timers, and store enough application state information to restore your application to its current state in case it is terminated later. 
      If your application supports background execution, this method is called instead of applicationWillTerminate: when the user quits.
@@ -128,6 +134,7 @@
 - (void)applicationWillTerminate:(UIApplication *)application
 {
     NSLog(@"app will terminate");
+    [[[[AccountUtil sharedAccountUtil] client] metadataCache] save];
     // Saves changes in the application's managed object context before the application terminates.
     //[self saveContext];
 }
@@ -0,0 +1,71 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#include <pthread.h>
+
+// A dictionary that can be read from any number of threads at once while another thread writes to it.
+// Reads share a reader-writer lock, so they only wait on each other while something is being written.
+// If it has a count limit, the oldest entries are evicted to make room for new ones.
+// Hits, misses and evictions are counted, to see how well each cache is doing.
+@interface ConcurrentCache : NSObject {
+    pthread_rwlock_t lock;
+    NSMutableDictionary *entries;
+    NSMutableArray *insertionOrder;     // only kept when there's a count limit
+    NSUInteger countLimit;
+    NSString *name;
+    
+    volatile int32_t hits;
+    volatile int32_t misses;
+    volatile int32_t evictions;
+}
+
+// A countLimit of 0 means the cache can grow without limit
+- (id) initWithName:(NSString *)name countLimit:(NSUInteger)countLimit;
+
+- (id) objectForKey:(id)key;
+- (void) setObject:(id)object forKey:(id)key;
+- (void) removeObjectForKey:(id)key;
+- (void) removeAllObjects;
+
+// Swaps in a whole new set of entries at once, so a reader sees either all the old ones or all the new ones,
+// never an empty cache part way through a refill. With a count limit, entries past it are evicted.
+- (void) replaceAllObjectsWithDictionary:(NSDictionary *)dictionary;
+
+- (NSUInteger) count;
+- (NSArray *) allKeys;
+- (NSArray *) allValues;
+
+@property (nonatomic, readonly) NSString *name;
+@property (nonatomic, readonly) NSUInteger countLimit;
+@property (nonatomic, readonly) NSUInteger hits;
+@property (nonatomic, readonly) NSUInteger misses;
+@property (nonatomic, readonly) NSUInteger evictions;
+
+- (void) resetStatistics;
+
+@end
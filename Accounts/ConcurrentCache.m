@@ -0,0 +1,221 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "ConcurrentCache.h"
+#include <libkern/OSAtomic.h>
+
+@implementation ConcurrentCache
+
+@synthesize name, countLimit;
+
+- (id) initWithName:(NSString *)cacheName countLimit:(NSUInteger)limit {
+    if(( self = [super init] )) {
+        pthread_rwlock_init(&lock, NULL);
+        entries = [[NSMutableDictionary alloc] init];
+        name = [cacheName copy];
+        countLimit = limit;
+        
+        if( countLimit > 0 )
+            insertionOrder = [[NSMutableArray alloc] initWithCapacity:countLimit];
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    pthread_rwlock_destroy(&lock);
+    [entries release];
+    [insertionOrder release];
+    [name release];
+    [super dealloc];
+}
+
+- (id) objectForKey:(id)key {
+    if( !key )
+        return nil;
+    
+    pthread_rwlock_rdlock(&lock);
+    // Retained before the lock is let go, so a writer on another thread can't free it out from under the caller
+    id object = [[entries objectForKey:key] retain];
+    pthread_rwlock_unlock(&lock);
+    
+    if( object )
+        OSAtomicIncrement32Barrier(&hits);
+    else
+        OSAtomicIncrement32Barrier(&misses);
+    
+    return [object autorelease];
+}
+
+- (void) setObject:(id)object forKey:(id)key {
+    if( !key )
+        return;
+    
+    if( !object ) {
+        [self removeObjectForKey:key];
+        return;
+    }
+    
+    // Evicted entries are released once we're out of the lock
+    NSMutableArray *evicted = nil;
+    
+    pthread_rwlock_wrlock(&lock);
+    
+    if( insertionOrder ) {
+        if( [entries objectForKey:key] )
+            [insertionOrder removeObject:key];
+        
+        while( [insertionOrder count] >= countLimit ) {
+            id oldest = [insertionOrder objectAtIndex:0];
+            
+            if( !evicted )
+                evicted = [NSMutableArray array];
+            
+            [evicted addObject:[entries objectForKey:oldest]];
+            [entries removeObjectForKey:oldest];
+            [insertionOrder removeObjectAtIndex:0];
+            OSAtomicIncrement32Barrier(&evictions);
+        }
+        
+        [insertionOrder addObject:key];
+    }
+    
+    [entries setObject:object forKey:key];
+    
+    pthread_rwlock_unlock(&lock);
+}
+
+- (void) removeObjectForKey:(id)key {
+    if( !key )
+        return;
+    
+    pthread_rwlock_wrlock(&lock);
+    id object = [[entries objectForKey:key] retain];
+    [entries removeObjectForKey:key];
+    [insertionOrder removeObject:key];
+    pthread_rwlock_unlock(&lock);
+    
+    [object release];
+}
+
+- (void) removeAllObjects {
+    pthread_rwlock_wrlock(&lock);
+    NSMutableDictionary *old = entries;
+    entries = [[NSMutableDictionary alloc] init];
+    [insertionOrder removeAllObjects];
+    pthread_rwlock_unlock(&lock);
+    
+    [old release];
+}
+
+- (void) replaceAllObjectsWithDictionary:(NSDictionary *)dictionary {
+    NSMutableDictionary *replacement = [[NSMutableDictionary alloc] initWithDictionary:dictionary];
+    NSMutableArray *order = nil;
+    int32_t evicted = 0;
+    
+    if( insertionOrder ) {
+        order = [[NSMutableArray alloc] initWithArray:[replacement allKeys]];
+        
+        while( [order count] > countLimit ) {
+            [replacement removeObjectForKey:[order lastObject]];
+            [order removeLastObject];
+            evicted++;
+        }
+    }
+    
+    pthread_rwlock_wrlock(&lock);
+    NSMutableDictionary *old = entries;
+    NSMutableArray *oldOrder = insertionOrder;
+    entries = replacement;
+    
+    if( order )
+        insertionOrder = order;
+    else
+        oldOrder = nil;
+    
+    pthread_rwlock_unlock(&lock);
+    
+    if( evicted > 0 )
+        OSAtomicAdd32Barrier(evicted, &evictions);
+    
+    [old release];
+    [oldOrder release];
+}
+
+- (NSUInteger) count {
+    pthread_rwlock_rdlock(&lock);
+    NSUInteger count = [entries count];
+    pthread_rwlock_unlock(&lock);
+    
+    return count;
+}
+
+- (NSArray *) allKeys {
+    pthread_rwlock_rdlock(&lock);
+    NSArray *keys = [entries allKeys];
+    pthread_rwlock_unlock(&lock);
+    
+    return keys;
+}
+
+- (NSArray *) allValues {
+    pthread_rwlock_rdlock(&lock);
+    NSArray *values = [entries allValues];
+    pthread_rwlock_unlock(&lock);
+    
+    return values;
+}
+
+- (NSUInteger) hits {
+    return (NSUInteger)hits;
+}
+
+- (NSUInteger) misses {
+    return (NSUInteger)misses;
+}
+
+- (NSUInteger) evictions {
+    return (NSUInteger)evictions;
+}
+
+static void resetCounter(volatile int32_t *counter) {
+    while( !OSAtomicCompareAndSwap32Barrier(*counter, 0, counter) )
+        ;
+}
+
+- (void) resetStatistics {
+    resetCounter(&hits);
+    resetCounter(&misses);
+    resetCounter(&evictions);
+}
+
+- (NSString *) description {
+    return [NSString stringWithFormat:@"%@: %u entries, %u hits, %u misses, %u evictions",
+            name, [self count], [self hits], [self misses], [self evictions]];
+}
+
+@end
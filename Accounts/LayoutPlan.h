@@ -0,0 +1,84 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+// A page layout, compiled down to what we need to query and render a record with it, so that
+// loading the next record on the same layout doesn't have to walk the layout and its describes again.
+
+typedef enum {
+    LayoutOpSectionStart,
+    LayoutOpRowStart,
+    LayoutOpField,
+    LayoutOpRowEnd,
+    LayoutOpSectionEnd
+} LayoutOpType;
+
+typedef struct {
+    LayoutOpType type;
+    NSString *text;         // the section heading, or the field label
+    NSString *field;        // the field to render
+    NSString *valueField;   // the field as it appears in the layout, whose value is checked for formula markup
+    BOOL useHeading;        // sections only
+    BOOL calculated;        // fields only, YES for formula fields
+} LayoutOp;
+
+@interface LayoutPlan : NSObject {
+    NSString *layoutId;
+    NSString *sObject;
+    NSArray *fieldList;
+    NSArray *soqlFieldLists;
+    LayoutOp *ops;
+    NSUInteger opCount, opCapacity;
+}
+
+- (id) initWithLayoutId:(NSString *)layoutId sObject:(NSString *)sObject;
+
+@property (nonatomic, readonly) NSString *layoutId;
+@property (nonatomic, readonly) NSString *sObject;
+
+// The fields to query for a record on this layout
+@property (nonatomic, retain) NSArray *fieldList;
+
+// The same fields joined up into one or more SOQL select lists, each short enough that a query for
+// a single record stays under SOQLMAXLENGTH. Every list starts with Id, and the fields of a
+// relationship are kept together so each related record comes back whole from one query.
+@property (nonatomic, readonly) NSArray *soqlFieldLists;
+
+// The queries that together read every field on this layout for a record
+- (NSArray *) queriesForRecordId:(NSString *)recordId;
+
+// The sections, rows and fields of the layout, in the order they're drawn
+- (const LayoutOp *) ops;
+- (NSUInteger) opCount;
+
+// Only used while the plan is being compiled
+- (void) addSectionStart:(NSString *)heading useHeading:(BOOL)useHeading;
+- (void) addField:(NSString *)field valueField:(NSString *)valueField label:(NSString *)label calculated:(BOOL)calculated;
+- (void) addOp:(LayoutOpType)type;
+
+@end
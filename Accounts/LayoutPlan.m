@@ -0,0 +1,171 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "LayoutPlan.h"
+#import "AccountUtil.h"
+
+@interface LayoutPlan (Private)
+- (NSArray *) splitFieldList:(NSArray *)list;
+@end
+
+@implementation LayoutPlan
+
+@synthesize layoutId, sObject, fieldList, soqlFieldLists;
+
+- (id) initWithLayoutId:(NSString *)lid sObject:(NSString *)sobj {
+    if(( self = [super init] )) {
+        layoutId = [lid copy];
+        sObject = [sobj copy];
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    for( NSUInteger i = 0; i < opCount; i++ ) {
+        [ops[i].text release];
+        [ops[i].field release];
+        [ops[i].valueField release];
+    }
+    
+    free(ops);
+    [layoutId release];
+    [sObject release];
+    [fieldList release];
+    [soqlFieldLists release];
+    [super dealloc];
+}
+
+- (void) setFieldList:(NSArray *)list {
+    if( list == fieldList )
+        return;
+    
+    [fieldList release];
+    fieldList = [list copy];
+    
+    [soqlFieldLists release];
+    soqlFieldLists = [[self splitFieldList:fieldList] retain];
+}
+
+- (NSArray *) splitFieldList:(NSArray *)list {
+    // what's left of the query once the select list is taken out, with room for the longest Id
+    NSString *rest = [NSString stringWithFormat:@"select Id, from %@ where id='%@' limit 1", sObject, @"000000000000000000"];
+    NSUInteger budget = SOQLMAXLENGTH - [rest length];
+    
+    // Group the fields by relationship, so that e.g. Owner.Name and Owner.Email aren't split across two queries
+    NSMutableArray *groups = [NSMutableArray array];
+    NSMutableDictionary *groupsByName = [NSMutableDictionary dictionary];
+    
+    for( NSString *field in list ) {
+        if( [[field lowercaseString] isEqualToString:@"id"] )
+            continue;
+        
+        NSRange dot = [field rangeOfString:@"."];
+        NSString *name = [( dot.location == NSNotFound ? field : [field substringToIndex:dot.location] ) lowercaseString];
+        NSMutableArray *group = [groupsByName objectForKey:name];
+        
+        if( !group ) {
+            group = [NSMutableArray array];
+            [groupsByName setObject:group forKey:name];
+            [groups addObject:group];
+        }
+        
+        [group addObject:field];
+    }
+    
+    NSMutableArray *ret = [NSMutableArray array];
+    NSMutableArray *chunk = [NSMutableArray array];
+    NSUInteger chunkLength = 0;
+    
+    for( NSArray *group in groups ) {
+        NSUInteger groupLength = [[group componentsJoinedByString:@","] length] + 1;
+        
+        if( [chunk count] > 0 && chunkLength + groupLength > budget ) {
+            [ret addObject:[[[NSArray arrayWithObject:@"Id"] arrayByAddingObjectsFromArray:chunk] componentsJoinedByString:@","]];
+            [chunk removeAllObjects];
+            chunkLength = 0;
+        }
+        
+        [chunk addObjectsFromArray:group];
+        chunkLength += groupLength;
+    }
+    
+    [ret addObject:[[[NSArray arrayWithObject:@"Id"] arrayByAddingObjectsFromArray:chunk] componentsJoinedByString:@","]];
+    
+    return ret;
+}
+
+- (NSArray *) queriesForRecordId:(NSString *)recordId {
+    NSMutableArray *ret = [NSMutableArray arrayWithCapacity:[soqlFieldLists count]];
+    
+    for( NSString *fields in soqlFieldLists )
+        [ret addObject:[NSString stringWithFormat:@"select %@ from %@ where id='%@' limit 1", fields, sObject, recordId]];
+    
+    return ret;
+}
+
+- (const LayoutOp *) ops {
+    return ops;
+}
+
+- (NSUInteger) opCount {
+    return opCount;
+}
+
+- (LayoutOp *) nextOp {
+    if( opCount == opCapacity ) {
+        opCapacity = MAX( 32, opCapacity * 2 );
+        ops = realloc( ops, opCapacity * sizeof(LayoutOp) );
+    }
+    
+    LayoutOp *op = &ops[opCount++];
+    memset( op, 0, sizeof(LayoutOp) );
+    
+    return op;
+}
+
+- (void) addSectionStart:(NSString *)heading useHeading:(BOOL)useHeading {
+    LayoutOp *op = [self nextOp];
+    op->type = LayoutOpSectionStart;
+    op->text = [heading copy];
+    op->useHeading = useHeading;
+}
+
+- (void) addField:(NSString *)field valueField:(NSString *)valueField label:(NSString *)label calculated:(BOOL)calculated {
+    LayoutOp *op = [self nextOp];
+    op->type = LayoutOpField;
+    op->field = [field copy];
+    op->valueField = [valueField copy];
+    op->text = [label copy];
+    op->calculated = calculated;
+}
+
+- (void) addOp:(LayoutOpType)type {
+    [self nextOp]->type = type;
+}
+
+@end
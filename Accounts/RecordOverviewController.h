@@ -60,6 +60,7 @@ enum {
 @property (nonatomic, retain) NSMutableArray *commButtons;
 @property (nonatomic, retain) UIView *commButtonBackground;
 @property (nonatomic, retain) FollowButton *followButton;
+@property (nonatomic, retain) ZKCancellationToken *loadToken;
 
 @property (nonatomic, assign) FieldPopoverButton *addressButton;
 @property (nonatomic, assign) UIButton *recenterButton;
@@ -71,6 +72,7 @@ enum {
 - (void) selectAccount:(NSDictionary *)acc;
 - (void) layoutView;
 - (void) loadAccount;
+- (void) cancelLoad;
 - (void) refreshSubNav;
 
 // Map view
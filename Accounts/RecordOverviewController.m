@@ -48,7 +48,7 @@ static float cornerRadius = 4.0f;
 
 @implementation RecordOverviewController
 
-@synthesize accountMap, mapView, gridView, addressButton, recenterButton, geocodeButton, detailButton, recordLayoutView, scrollView, commButtons, commButtonBackground, followButton;
+@synthesize accountMap, mapView, gridView, addressButton, recenterButton, geocodeButton, detailButton, recordLayoutView, scrollView, commButtons, commButtonBackground, followButton, loadToken;
 
 - (id) initWithFrame:(CGRect)frame {
     if((self = [super initWithFrame:frame])) {      
@@ -337,8 +337,9 @@ static float cornerRadius = 4.0f;
     
     int fieldLayoutTag = 11;
     
+    // a different account was picked while the last one was still loading, drop that load and start on this one.
     if( isLoading )
-        return;
+        [self cancelLoad];
     
     if( self.recordLayoutView ) {
         [self.recordLayoutView removeFromSuperview];
@@ -409,85 +410,102 @@ static float cornerRadius = 4.0f;
     [self.navBar pushNavigationItem:loading animated:NO];
     [loading release];
     
-    NSString *fieldsToQuery = @"";
-    
     // Only query the fields that will be displayed in the page layout for this account, given its record type and page layout.
     NSString *layoutId = [[[AccountUtil sharedAccountUtil] layoutForRecord:self.account] Id];
     
-    fieldsToQuery = [[[AccountUtil sharedAccountUtil] fieldListForLayoutId:layoutId] componentsJoinedByString:@","];
-    
     // Build and execute the query
     [[AccountUtil sharedAccountUtil] startNetworkAction];
     [DSBezelActivityView newActivityViewForView:self.view];
     
-    NSString *queryString = [NSString stringWithFormat:@"select %@ from Account where id='%@' limit 1",
-                             fieldsToQuery, [self.account objectForKey:@"Id"]];
-    
-    NSLog(@"SOQL %@", queryString);
-    
-    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,0), ^(void) {
-        ZKQueryResult *qr = nil;
+    // the query can be cancelled if another account is picked before it's done
+    self.loadToken = [[AccountUtil sharedAccountUtil] loadRecordWithId:[self.account objectForKey:@"Id"]
+                                                              layoutId:layoutId
+                                                               sObject:@"Account"
+                                                             failBlock:^(NSException *e) {
+        // Nuclear option - forces a logout in case loading this account failed
+        [[AccountUtil sharedAccountUtil] receivedException:e];
+        [[AccountUtil sharedAccountUtil] endNetworkAction];
+        [DSBezelActivityView removeViewAnimated:NO];
+        isLoading = NO;
+        self.loadToken = nil;
+        
+        [PRPAlertView showWithTitle:NSLocalizedString(@"Alert", @"Alert")
+                            message:NSLocalizedString(@"Failed to load this Account.", @"Account load failed")
+                        cancelTitle:NSLocalizedString(@"Cancel", @"Cancel")
+                        cancelBlock:nil
+                         otherTitle:NSLocalizedString(@"Retry", @"Retry")
+                         otherBlock: ^ (void) {
+                             [self loadAccount];
+                         }];
+    } completeBlock:^(ZKSObject *ob) {
+        isLoading = NO;
+        self.loadToken = nil;
         
-        @try {
-            qr = [[[AccountUtil sharedAccountUtil] client] query:queryString];
-        } @catch( NSException *e ) {
-            // Nuclear option - forces a logout in case loading this account failed
-            [[AccountUtil sharedAccountUtil] receivedException:e];
+        if( !ob ) {
             [[AccountUtil sharedAccountUtil] endNetworkAction];
             [DSBezelActivityView removeViewAnimated:NO];
-            isLoading = NO;
             
             [PRPAlertView showWithTitle:NSLocalizedString(@"Alert", @"Alert")
                                 message:NSLocalizedString(@"Failed to load this Account.", @"Account load failed")
-                            cancelTitle:NSLocalizedString(@"Cancel", @"Cancel")
+                            cancelTitle:nil
                             cancelBlock:nil
-                             otherTitle:NSLocalizedString(@"Retry", @"Retry")
-                             otherBlock: ^ (void) {
-                                 [self loadAccount];
-                             }];
+                             otherTitle:NSLocalizedString(@"OK", @"OK")
+                             otherBlock:nil];
             return;
         }
         
-        dispatch_async(dispatch_get_main_queue(), ^(void) { 
-            isLoading = NO;
-            ZKSObject *ob = [[qr records] objectAtIndex:0];
-            self.account = [ob fields];
-            self.recordLayoutView = [[AccountUtil sharedAccountUtil] layoutViewForsObject:ob withTarget:self.detailViewController singleColumn:YES];
-            self.recordLayoutView.tag = fieldLayoutTag;
+        self.account = [ob fields];
+        self.recordLayoutView = [[AccountUtil sharedAccountUtil] layoutViewForsObject:ob withTarget:self.detailViewController singleColumn:YES];
+        self.recordLayoutView.tag = fieldLayoutTag;
+        [[AccountUtil sharedAccountUtil] logFirstAccountRender];
         
-            [[AccountUtil sharedAccountUtil] endNetworkAction];
-            
-            UINavigationItem *title = [[[UINavigationItem alloc] initWithTitle:[self.account objectForKey:@"Name"]] autorelease];
-            title.hidesBackButton = YES;
-            
-            if( [RootViewController isPortrait] )
-                title.leftBarButtonItem = self.detailViewController.browseButton;
-            
-            if( [[AccountUtil sharedAccountUtil] isObjectChatterEnabled:@"Account"] ) {                
-                self.followButton = [FollowButton followButtonWithUserId:[[[[AccountUtil sharedAccountUtil] client] currentUserInfo] userId]
-                                                                parentId:[self.account objectForKey:@"Id"]];
-                self.followButton.delegate = self;
-                
-                [title setRightBarButtonItem:[FollowButton loadingBarButtonItem]];
-            }
-            
-            [DSBezelActivityView removeViewAnimated:YES];
-            [self.navBar pushNavigationItem:title animated:YES];
-            [self.followButton performSelector:@selector(loadFollowState) withObject:nil afterDelay:0.5];
+        [[AccountUtil sharedAccountUtil] endNetworkAction];
+        
+        UINavigationItem *title = [[[UINavigationItem alloc] initWithTitle:[self.account objectForKey:@"Name"]] autorelease];
+        title.hidesBackButton = YES;
+        
+        if( [RootViewController isPortrait] )
+            title.leftBarButtonItem = self.detailViewController.browseButton;
+        
+        if( [[AccountUtil sharedAccountUtil] isObjectChatterEnabled:@"Account"] ) {                
+            self.followButton = [FollowButton followButtonWithUserId:[[[[AccountUtil sharedAccountUtil] client] currentUserInfo] userId]
+                                                            parentId:[self.account objectForKey:@"Id"]];
+            self.followButton.delegate = self;
             
-            self.gridView.hidden = NO;
-            [self configureMap];
+            [title setRightBarButtonItem:[FollowButton loadingBarButtonItem]];
+        }
+        
+        [DSBezelActivityView removeViewAnimated:YES];
+        [self.navBar pushNavigationItem:title animated:YES];
+        [self.followButton performSelector:@selector(loadFollowState) withObject:nil afterDelay:0.5];
+        
+        self.gridView.hidden = NO;
+        [self configureMap];
            
-            [self.scrollView addSubview:self.recordLayoutView];
-            [self.scrollView setContentOffset:CGPointZero animated:NO];
-            
-            [self setupCommButtons];
-            
-            [self layoutView];
-            
-            [self.rootViewController allSubNavSelectAccountWithId:[self.account objectForKey:@"Id"]];
-        });
-    });    
+        [self.scrollView addSubview:self.recordLayoutView];
+        [self.scrollView setContentOffset:CGPointZero animated:NO];
+        
+        [self setupCommButtons];
+        
+        [self layoutView];
+        
+        [self.rootViewController allSubNavSelectAccountWithId:[self.account objectForKey:@"Id"]];
+    }];
+}
+
+- (void) cancelLoad {
+    if( !isLoading )
+        return;
+    
+    [self.loadToken cancel];
+    self.loadToken = nil;
+    isLoading = NO;
+    
+    [[AccountUtil sharedAccountUtil] endNetworkAction];
+    [DSBezelActivityView removeViewAnimated:NO];
+    
+    // the Loading... item
+    [self.navBar popNavigationItemAnimated:NO];
 }
 
 - (void)dealloc {
@@ -496,6 +514,8 @@ static float cornerRadius = 4.0f;
      name:UIDeviceOrientationDidChangeNotification 
      object:nil];
     
+    [loadToken cancel];
+    [loadToken release];
     [commButtonBackground release];
     [scrollView release];
     [recordLayoutView release];
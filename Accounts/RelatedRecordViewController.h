@@ -31,7 +31,6 @@
 #import "FollowButton.h"
 
 @interface RelatedRecordViewController : FlyingWindowController <UIScrollViewDelegate, FollowButtonDelegate, UIActionSheetDelegate> {
-    int metadataCount;
 }
 
 // The stages of loading a related record.
@@ -43,8 +43,6 @@
     if(( self = [super initWithFrame:frame] )) {
         self.view.backgroundColor = [UIColor colorWithPatternImage:[UIImage imageNamed:@"panelBG.png"]];
         
-        metadataCount = 0;
-        
         self.fieldScrollView = [[[UIScrollView alloc] initWithFrame:CGRectMake( 5,
                                                                 self.navBar.frame.size.height,
                                                                 frame.size.width - 5,
@@ -99,11 +97,10 @@
             if( relatedsObjects && [relatedsObjects count] > 0 ) {
                 self.loadingStage = LoadRelatedDescribes;
                 
-                for( NSString *relatedsObject in relatedsObjects )
-                    [[AccountUtil sharedAccountUtil] describesObject:relatedsObject
-                                                       completeBlock:^(ZKDescribeSObject * sObject) {
-                                                           [self metadataOperationComplete];
-                                                       }];
+                [[AccountUtil sharedAccountUtil] describesObjects:relatedsObjects
+                                                    completeBlock:^(void) {
+                                                        [self metadataOperationComplete];
+                                                    }];
             } else                
                 [[AccountUtil sharedAccountUtil] describeLayoutForsObject:self.sObjectType
                                                                    completeBlock:^(ZKDescribeLayoutResult * layoutDescribe) {
@@ -111,111 +108,87 @@
                                                                    }];
             break;
         case LoadRelatedDescribes:
-            metadataCount++;
-            
-            if( metadataCount == [[[AccountUtil sharedAccountUtil] relatedsObjectsOnsObject:self.sObjectType] count] ) {
-                metadataCount = 0;                
-                [[AccountUtil sharedAccountUtil] describeLayoutForsObject:self.sObjectType
-                                                                   completeBlock:^(ZKDescribeLayoutResult * layoutDescribe) {
-                                                                       [self loadRecord];
-                                                                   }];
-            }
+            [[AccountUtil sharedAccountUtil] describeLayoutForsObject:self.sObjectType
+                                                               completeBlock:^(ZKDescribeLayoutResult * layoutDescribe) {
+                                                                   [self loadRecord];
+                                                               }];
             break;
         default: break;
     }
 }
 
 - (void) loadRecord {
-    NSString *fieldsToQuery = @"";
-    
     // Only query the fields that will be displayed in the page layout for this account, given its record type and page layout.
     NSString *layoutId = [[[AccountUtil sharedAccountUtil] layoutForRecord:[self.record fields]] Id];
     
-    fieldsToQuery = [[[AccountUtil sharedAccountUtil] fieldListForLayoutId:layoutId] componentsJoinedByString:@","];
-    
     // Build and execute the query
     [[AccountUtil sharedAccountUtil] startNetworkAction];
     
-    NSString *queryString = [NSString stringWithFormat:@"select %@ from %@ where id='%@' limit 1",
-                             fieldsToQuery, 
-                             self.sObjectType,
-                             [self.record fieldValue:@"Id"]];
-    
-    NSLog(@"SOQL %@", queryString);
-    
-    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,0), ^(void) {
-        ZKQueryResult *qr = nil;
-        
-        @try {
-            qr = [[[AccountUtil sharedAccountUtil] client] query:queryString];
-        } @catch( NSException *e ) {
-            [[AccountUtil sharedAccountUtil] receivedException:e];
-            [[AccountUtil sharedAccountUtil] endNetworkAction];
-            [DSBezelActivityView removeViewAnimated:NO];
-            
-            return;
-        }
+    [[AccountUtil sharedAccountUtil] loadRecordWithId:[self.record fieldValue:@"Id"]
+                                             layoutId:layoutId
+                                              sObject:self.sObjectType
+                                            failBlock:^(NSException *e) {
+        [[AccountUtil sharedAccountUtil] receivedException:e];
+        [[AccountUtil sharedAccountUtil] endNetworkAction];
+        [DSBezelActivityView removeViewAnimated:NO];
+    } completeBlock:^(ZKSObject *ob) {
+        [[AccountUtil sharedAccountUtil] endNetworkAction];
+        [DSBezelActivityView removeViewAnimated:YES];
         
-        dispatch_async(dispatch_get_main_queue(), ^(void) { 
-            [[AccountUtil sharedAccountUtil] endNetworkAction];
-            [DSBezelActivityView removeViewAnimated:YES];
+        if( ob ) {
+            self.record = ob;
             
-            if( qr && [qr records] && [[qr records] count] > 0 ) {
-                ZKSObject *ob = [[qr records] objectAtIndex:0];
-                self.record = ob;
-                
-                [[AccountUtil sharedAccountUtil] describesObject:[self.record type]
-                                                   completeBlock:^(ZKDescribeSObject *desc) {
-                                                       NSString *nameField = [[AccountUtil sharedAccountUtil] nameFieldForsObject:self.sObjectType];
-                                                       
-                                                       UINavigationItem *title = [[[UINavigationItem alloc] initWithTitle:[AccountUtil trimWhiteSpaceFromString:
-                                                                                                                           [NSString stringWithFormat:@"%@%@",
-                                                                                                                            [desc label],
-                                                                                                                            ( [self.record fieldValue:nameField] ? 
-                                                                                                                             [NSString stringWithFormat:@" - %@",
-                                                                                                                              [self.record fieldValue:nameField]] : @"" )]]] autorelease];
-                                                       title.hidesBackButton = YES;
-                                                       
-                                                       if( [[AccountUtil sharedAccountUtil] isObjectChatterEnabled:self.sObjectType] ) {                                                           
-                                                           self.followButton = [FollowButton followButtonWithUserId:[[[[AccountUtil sharedAccountUtil] client] currentUserInfo] userId]
-                                                                                                           parentId:[self.record id]];
-                                                           self.followButton.delegate = self;
-                                                           
-                                                           [title setLeftBarButtonItem:[FollowButton loadingBarButtonItem]];
-                                                       }
-                                                       
-                                                       title.rightBarButtonItem = [[[UIBarButtonItem alloc] initWithBarButtonSystemItem:UIBarButtonSystemItemAction
-                                                                                                                                 target:self
-                                                                                                                                 action:@selector(tappedActionButton:)] autorelease];
+            [[AccountUtil sharedAccountUtil] describesObject:[self.record type]
+                                               completeBlock:^(ZKDescribeSObject *desc) {
+                                                   NSString *nameField = [[AccountUtil sharedAccountUtil] nameFieldForsObject:self.sObjectType];
+                                                   
+                                                   UINavigationItem *title = [[[UINavigationItem alloc] initWithTitle:[AccountUtil trimWhiteSpaceFromString:
+                                                                                                                       [NSString stringWithFormat:@"%@%@",
+                                                                                                                        [desc label],
+                                                                                                                        ( [self.record fieldValue:nameField] ? 
+                                                                                                                         [NSString stringWithFormat:@" - %@",
+                                                                                                                          [self.record fieldValue:nameField]] : @"" )]]] autorelease];
+                                                   title.hidesBackButton = YES;
+                                                   
+                                                   if( [[AccountUtil sharedAccountUtil] isObjectChatterEnabled:self.sObjectType] ) {                                                           
+                                                       self.followButton = [FollowButton followButtonWithUserId:[[[[AccountUtil sharedAccountUtil] client] currentUserInfo] userId]
+                                                                                                       parentId:[self.record id]];
+                                                       self.followButton.delegate = self;
                                                        
-                                                       [self.navBar pushNavigationItem:title animated:YES];
-                                                       
-                                                       [self.followButton performSelector:@selector(loadFollowState) withObject:nil afterDelay:0.5];
-                                                       
-                                                       UIView *recordView = [[AccountUtil sharedAccountUtil] layoutViewForsObject:ob withTarget:self.detailViewController singleColumn:NO];
-                                                       
-                                                       CGRect r = recordView.frame;
-                                                       r.size.width = self.view.frame.size.width;
-                                                       [recordView setFrame:r];
-                                                       
-                                                       [self.fieldScrollView addSubview:recordView];
-                                                       [self.fieldScrollView setContentOffset:CGPointZero animated:NO];
-                                                       [self.fieldScrollView setContentSize:CGSizeMake( self.fieldScrollView.frame.size.width, 
-                                                                                                       MAX( self.fieldScrollView.frame.size.height + 1, recordView.frame.size.height ))]; 
-                                                   }];
-            } else {
-                // failed to load this record for some reason
-                [PRPAlertView showWithTitle:NSLocalizedString(@"Alert", nil)
-                                    message:NSLocalizedString(@"Unable to load this record.", )
-                                cancelTitle:nil
-                                cancelBlock:nil 
-                                 otherTitle:NSLocalizedString(@"OK", nil) 
-                                 otherBlock:^(void) {
-                                     [self.detailViewController tearOffFlyingWindowsStartingWith:self inclusive:YES];
-                                 }];
-            }
-        });
-    });    
+                                                       [title setLeftBarButtonItem:[FollowButton loadingBarButtonItem]];
+                                                   }
+                                                   
+                                                   title.rightBarButtonItem = [[[UIBarButtonItem alloc] initWithBarButtonSystemItem:UIBarButtonSystemItemAction
+                                                                                                                             target:self
+                                                                                                                             action:@selector(tappedActionButton:)] autorelease];
+                                                   
+                                                   [self.navBar pushNavigationItem:title animated:YES];
+                                                   
+                                                   [self.followButton performSelector:@selector(loadFollowState) withObject:nil afterDelay:0.5];
+                                                   
+                                                   UIView *recordView = [[AccountUtil sharedAccountUtil] layoutViewForsObject:ob withTarget:self.detailViewController singleColumn:NO];
+                                                   
+                                                   CGRect r = recordView.frame;
+                                                   r.size.width = self.view.frame.size.width;
+                                                   [recordView setFrame:r];
+                                                   
+                                                   [self.fieldScrollView addSubview:recordView];
+                                                   [self.fieldScrollView setContentOffset:CGPointZero animated:NO];
+                                                   [self.fieldScrollView setContentSize:CGSizeMake( self.fieldScrollView.frame.size.width, 
+                                                                                                   MAX( self.fieldScrollView.frame.size.height + 1, recordView.frame.size.height ))]; 
+                                               }];
+        } else {
+            // failed to load this record for some reason
+            [PRPAlertView showWithTitle:NSLocalizedString(@"Alert", nil)
+                                message:NSLocalizedString(@"Unable to load this record.", )
+                            cancelTitle:nil
+                            cancelBlock:nil 
+                             otherTitle:NSLocalizedString(@"OK", nil) 
+                             otherBlock:^(void) {
+                                 [self.detailViewController tearOffFlyingWindowsStartingWith:self inclusive:YES];
+                             }];
+        }
+    }];
 }
 
 - (void)scrollViewDidScroll:(UIScrollView *)scrollView {
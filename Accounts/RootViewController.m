@@ -76,6 +76,12 @@ BOOL useClientLogin = NO;
     
     self.client = [[[ZKSforceClient alloc] init] autorelease];
     [client setClientId:SOAPClientID];
+    
+    // account lists only select a few narrow fields, so let the batch size grow to cut down on queryMore round trips
+    [client setAdaptiveQueryBatchSize:YES];
+    
+    // and once those batches get big, decode them on every core rather than just the one that read them
+    [client setDecodeConcurrency:[[NSProcessInfo processInfo] activeProcessorCount]];
 }
 
 - (void) appFinishedLaunching {   
@@ -120,6 +126,7 @@ BOOL useClientLogin = NO;
 - (void) removeSubNavControllers {
     if( self.subNavControllers ) {
         for( SubNavViewController *controller in self.subNavControllers ) {
+            [controller cancelQueries];
             [controller.view removeFromSuperview];
             controller = nil;
         }
@@ -411,6 +418,9 @@ BOOL useClientLogin = NO;
     
     [[AccountUtil sharedAccountUtil] setClient:client];
     
+    // Describes from the last session can be used straight away while we fetch new ones
+    [[AccountUtil sharedAccountUtil] openMetadataCache];
+    
     // Global describe to build a list of chatter-enabled sObjects
     [[AccountUtil sharedAccountUtil] describeGlobal:^(void) {
         [self appDidCompleteLoginMetadataOperation];
@@ -446,6 +456,10 @@ BOOL useClientLogin = NO;
     metadataComplete = 0;
     NSLog(@"app did login async complete");
     
+    // Describe everything Account records link to in a few batched calls now, rather than one
+    // at a time as each related record is opened
+    [[AccountUtil sharedAccountUtil] prefetchDescribesForsObject:@"Account"];
+    
     [self addSubNavControllers];
     [self switchSubNavView:SubNavOwnedAccounts];
     [self.detailViewController eventLogInOrOut];    
@@ -56,6 +56,7 @@ enum SubNavTableType {
 @property (nonatomic, retain) UIActionSheet *listActionSheet;
 @property (nonatomic, retain) UILabel *rowCountLabel;
 @property (nonatomic, retain) UIToolbar *bottomBar;
+@property (nonatomic, retain) ZKCancellationToken *queryToken;
 
 @property (nonatomic, assign) UIButton *titleButton;
 @property (nonatomic, assign) DetailViewController *detailViewController;
@@ -73,6 +74,8 @@ enum SubNavTableType {
 - (void) refreshResult:(NSArray *)results;
 - (void) setupNavBar;
 - (void) queryMore:(NSString *)queryLocator;
+- (void) cancelQueries;
+- (BOOL) endQuery:(ZKCancellationToken *)token;
 
 - (void) cancelSearch;
 - (void) searchTableView;
@@ -40,7 +40,7 @@
 
 @implementation SubNavViewController
 
-@synthesize myRecords, detailViewController, searchBar, searchResults, rootViewController, navigationBar, titleButton, pullRefreshTableViewController, subNavTableType, listActionSheet, rowCountLabel, bottomBar;
+@synthesize myRecords, detailViewController, searchBar, searchResults, rootViewController, navigationBar, titleButton, pullRefreshTableViewController, subNavTableType, listActionSheet, rowCountLabel, bottomBar, queryToken;
 
 // Maximum length of a search term
 static int maxSearchLength = 35;
@@ -54,6 +54,9 @@ static int helperTag = 11;
 // Maximum number of accounts to load via queryMore chains
 static int maxAccounts = 50000;
 
+// How many queryMore batches can be fetched ahead of the one being merged
+static int queryMoreLookahead = 2;
+
 static NSString *indexAlphabet = @"#ABCDEFGHIJKLMNOPQRSTUVWXYZ";
 
 - (id) initWithTableType:(enum SubNavTableType)tableType {
@@ -265,6 +268,7 @@ static NSString *indexAlphabet = @"#ABCDEFGHIJKLMNOPQRSTUVWXYZ";
 }
 
 - (void) clearRecords {
+    [self cancelQueries];
     [self.myRecords removeAllObjects];    
     storedSize = 0;
     
@@ -292,6 +296,9 @@ static NSString *indexAlphabet = @"#ABCDEFGHIJKLMNOPQRSTUVWXYZ";
     
     if( ![[[AccountUtil sharedAccountUtil] client] loggedIn] || ![[[AccountUtil sharedAccountUtil] client] currentUserInfo] )
         return;
+    
+    // drop whatever's still loading for the old list, including any queryMore chain
+    [self cancelQueries];
         
     [[AccountUtil sharedAccountUtil] startNetworkAction];
     
@@ -299,89 +306,96 @@ static NSString *indexAlphabet = @"#ABCDEFGHIJKLMNOPQRSTUVWXYZ";
         [DSBezelActivityView newActivityViewForView:self.view];
     
     if( subNavTableType == SubNavFollowedAccounts && [[AccountUtil sharedAccountUtil] isObjectChatterEnabled:@"Account"] ) {        
+        // the refresh of followed accounts runs in the background before there's a call to cancel,
+        // so the list gets a token of its own for the whole thing, which cancels the retrieve too.
+        ZKCancellationToken *token = [ZKCancellationToken token];
+        self.queryToken = token;
+        
         // Refresh the list of accounts I'm following, then query those IDs
         dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,0), ^(void) {
             @try {
                 [[AccountUtil sharedAccountUtil] refreshFollowedAccounts];
             } @catch( NSException *e ) {
-                [[AccountUtil sharedAccountUtil] endNetworkAction];
-                
-                if( [self isEqual:[self.rootViewController currentSubNavViewController]] )
-                    [DSBezelActivityView removeViewAnimated:YES];
-                
-                [[AccountUtil sharedAccountUtil] receivedException:e];
-                [(PullRefreshTableViewController *)self.pullRefreshTableViewController stopLoading];
-                
-                [PRPAlertView showWithTitle:NSLocalizedString(@"Alert", @"Alert")
-                                    message:NSLocalizedString(@"Failed to load Accounts.", @"Account query failed")
-                                cancelTitle:NSLocalizedString(@"Cancel", @"Cancel")
-                                cancelBlock:nil 
-                                 otherTitle:NSLocalizedString(@"Retry", @"Retry")
-                                 otherBlock: ^(void) {
-                                     [self refresh];
-                                 }];
+                dispatch_async(dispatch_get_main_queue(), ^(void) {
+                    if( ![self endQuery:token] )
+                        return;
+                    
+                    [[AccountUtil sharedAccountUtil] endNetworkAction];
+                    
+                    if( [self isEqual:[self.rootViewController currentSubNavViewController]] )
+                        [DSBezelActivityView removeViewAnimated:YES];
+                    
+                    [[AccountUtil sharedAccountUtil] receivedException:e];
+                    [(PullRefreshTableViewController *)self.pullRefreshTableViewController stopLoading];
+                    
+                    [PRPAlertView showWithTitle:NSLocalizedString(@"Alert", @"Alert")
+                                        message:NSLocalizedString(@"Failed to load Accounts.", @"Account query failed")
+                                    cancelTitle:NSLocalizedString(@"Cancel", @"Cancel")
+                                    cancelBlock:nil 
+                                     otherTitle:NSLocalizedString(@"Retry", @"Retry")
+                                     otherBlock: ^(void) {
+                                         [self refresh];
+                                     }];
+                });
                 return;
             }
             
             dispatch_async(dispatch_get_main_queue(), ^(void) {
+                // cancelled, or another refresh has started, while we were getting the followed accounts
+                if( [token isCancelled] || token != self.queryToken )
+                    return;
+                
                 // Do we follow any accounts?
                 if( [[[AccountUtil sharedAccountUtil] getFollowedAccounts] count] == 0 ) {
+                    [self endQuery:token];
                     [self refreshResult:nil];
                     return;
                 }
                 
-                NSMutableString *followedAccountIds = [NSMutableString stringWithString:@""];
+                NSString *fields = ( [[AccountUtil sharedAccountUtil] isObjectRecordTypeEnabled:@"Account"] ? @"Id, Name, RecordTypeId" : @"Id, Name" );
                 
-                for( NSString *followedAccount in [[AccountUtil sharedAccountUtil] getFollowedAccounts] )
-                    [followedAccountIds appendFormat:@"%@'%@'",
-                     ( [followedAccountIds length] > 0 ? @"," : @"" ),
-                     followedAccount];
-
-                NSString *queryString = [NSString stringWithFormat:@"select id, name%@ from Account where id in (%@) order by name asc",
-                                         ( [[AccountUtil sharedAccountUtil] isObjectRecordTypeEnabled:@"Account"] ? @", recordtypeid" : @"" ),
-                                         followedAccountIds];
-                
-                NSLog(@"SOQL %@",queryString);
-                
-                // Nested async?
-                dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,0), ^(void) {
-                    ZKQueryResult *qr = nil;
+                // retrieve splits the ids up and fetches them in parallel, rather than building a huge soql string
+                ZKCancellationToken *retrieveToken = [[[AccountUtil sharedAccountUtil] client] performRetrieve:fields 
+                                                                                                       sobject:@"Account" 
+                                                                                                           ids:[[AccountUtil sharedAccountUtil] getFollowedAccounts] 
+                                                                                                     failBlock:^(NSException *e) {
+                    if( ![self endQuery:token] )
+                        return;
                     
-                    @try {
-                        qr = [[[AccountUtil sharedAccountUtil] client] query:queryString];
-                    } @catch( NSException *e ) {
-                        [[AccountUtil sharedAccountUtil] endNetworkAction];
-                        
-                        if( [self isEqual:[self.rootViewController currentSubNavViewController]] )
-                            [DSBezelActivityView removeViewAnimated:YES];
-                        
-                        [[AccountUtil sharedAccountUtil] receivedException:e];
-                        [(PullRefreshTableViewController *)self.pullRefreshTableViewController stopLoading];
-                        
-                        [PRPAlertView showWithTitle:NSLocalizedString(@"Alert", @"Alert")
-                                            message:NSLocalizedString(@"Failed to load Accounts.", @"Account query failed")
-                                        cancelTitle:NSLocalizedString(@"Cancel", @"Cancel")
-                                        cancelBlock:nil 
-                                         otherTitle:NSLocalizedString(@"Retry", @"Retry")
-                                         otherBlock: ^(void) {
-                                             [self refresh];
-                                         }];
-                        
+                    [[AccountUtil sharedAccountUtil] endNetworkAction];
+                    
+                    if( [self isEqual:[self.rootViewController currentSubNavViewController]] )
+                        [DSBezelActivityView removeViewAnimated:YES];
+                    
+                    [[AccountUtil sharedAccountUtil] receivedException:e];
+                    [(PullRefreshTableViewController *)self.pullRefreshTableViewController stopLoading];
+                    
+                    [PRPAlertView showWithTitle:NSLocalizedString(@"Alert", @"Alert")
+                                        message:NSLocalizedString(@"Failed to load Accounts.", @"Account query failed")
+                                    cancelTitle:NSLocalizedString(@"Cancel", @"Cancel")
+                                    cancelBlock:nil 
+                                     otherTitle:NSLocalizedString(@"Retry", @"Retry")
+                                     otherBlock: ^(void) {
+                                         [self refresh];
+                                     }];
+                } completeBlock:^(NSDictionary *accounts) {
+                    if( ![self endQuery:token] )
                         return;
-                    }
                     
-                    dispatch_async(dispatch_get_main_queue(), ^(void) {
-                        if( qr && [qr records] && [[qr records] count] > 0 ) {
-                            [self refreshResult:[qr records]];
-                            
-                            if( [qr queryLocator] ) {
-                                [DSBezelActivityView newActivityViewForView:self.view];
-                                [self queryMore:[qr queryLocator]];
-                            }
-                        } else
-                            [self refreshResult:nil];
-                    });
-                });
+                    if( [accounts count] > 0 ) {
+                        // retrieve doesn't sort, so put them in name order like the query did
+                        NSArray *sorted = [[accounts allValues] sortedArrayUsingComparator:^NSComparisonResult(id a, id b) {
+                            return [[a fieldValue:@"Name"] localizedCaseInsensitiveCompare:[b fieldValue:@"Name"]];
+                        }];
+                        
+                        [self refreshResult:sorted];
+                    } else
+                        [self refreshResult:nil];
+                }];
+                
+                [token addCancelHandler:^(void) {
+                    [retrieveToken cancel];
+                }];
             });
         });
     } else if( subNavTableType == SubNavOwnedAccounts ) {
@@ -391,39 +405,65 @@ static NSString *indexAlphabet = @"#ABCDEFGHIJKLMNOPQRSTUVWXYZ";
         
         NSLog(@"SOQL %@",queryString);
         
-        // run the query in the background thread, when its done, update the ui.
-        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,0), ^(void) {
-            ZKQueryResult *qr = nil;
+        // run the query without blocking the ui, when its done, update the ui.
+        __block ZKCancellationToken *token = nil;
+        
+        token = [[[AccountUtil sharedAccountUtil] client] performRecordBatchQuery:queryString failBlock:^(NSException *e) {
+            if( ![self endQuery:token] )
+                return;
             
-            @try {
-                qr = [[[AccountUtil sharedAccountUtil] client] query:queryString];
-            } @catch( NSException *e ) {
-                [[AccountUtil sharedAccountUtil] endNetworkAction];
-                
-                if( [self isEqual:[self.rootViewController currentSubNavViewController]] )
-                    [DSBezelActivityView removeViewAnimated:YES];
-                
-                [[AccountUtil sharedAccountUtil] receivedException:e];
-                [(PullRefreshTableViewController *)self.pullRefreshTableViewController stopLoading];
-                
+            [[AccountUtil sharedAccountUtil] endNetworkAction];
+            
+            if( [self isEqual:[self.rootViewController currentSubNavViewController]] )
+                [DSBezelActivityView removeViewAnimated:YES];
+            
+            [[AccountUtil sharedAccountUtil] receivedException:e];
+            [(PullRefreshTableViewController *)self.pullRefreshTableViewController stopLoading];
+        } completeBlock:^(ZKRecordBatch *qr) {
+            if( ![self endQuery:token] )
                 return;
-            }
             
-            dispatch_async(dispatch_get_main_queue(), ^(void) {
-                if( qr && [qr records] && [[qr records] count] > 0 ) {
-                    [self refreshResult:[qr records]];
-                    
-                    if( [qr queryLocator] ) {
-                        [DSBezelActivityView newActivityViewForView:self.view];
-                        [self queryMore:[qr queryLocator]];
-                    }
-                } else
-                    [self refreshResult:nil];
-            });
-        });
+            if( [qr count] > 0 ) {
+                [self refreshResult:[qr records]];
+                
+                if( [qr queryLocator] ) {
+                    [DSBezelActivityView newActivityViewForView:self.view];
+                    [self queryMore:[qr queryLocator]];
+                }
+            } else
+                [self refreshResult:nil];
+        }];
+        
+        self.queryToken = token;
     }
 }
 
+// Called when a query finishes, returns NO if it was cancelled or replaced in the meantime, in which
+// case cancelQueries has already ended its network action. Otherwise it's no longer the query in flight,
+// and the caller ends its network action, so it's ended exactly once either way.
+- (BOOL) endQuery:(ZKCancellationToken *)token {
+    if( !token || token != self.queryToken || [token isCancelled] )
+        return NO;
+    
+    self.queryToken = nil;
+    return YES;
+}
+
+- (void) cancelQueries {
+    if( !self.queryToken )
+        return;
+    
+    // each query in flight is holding one network action open
+    [self.queryToken cancel];
+    self.queryToken = nil;
+    queryingMore = NO;
+    
+    [[AccountUtil sharedAccountUtil] endNetworkAction];
+    
+    if( [self isEqual:[self.rootViewController currentSubNavViewController]] )
+        [DSBezelActivityView removeViewAnimated:NO];
+}
+
 - (void) refreshResult:(NSArray *)results {
     [[AccountUtil sharedAccountUtil] endNetworkAction];
     
@@ -496,60 +536,74 @@ static NSString *indexAlphabet = @"#ABCDEFGHIJKLMNOPQRSTUVWXYZ";
     
     NSLog(@"querying more with locator %@", queryLocator);
     
+    // the whole chain holds one network action open, cancelQueries releases it if we stop early.
     [[AccountUtil sharedAccountUtil] startNetworkAction];
     
-    // run the query in the background thread, when its done, update the ui.
-    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,0), ^(void) {
-        ZKQueryResult *qr = nil;
-        
-        @try {
-            qr = [[[AccountUtil sharedAccountUtil] client] queryMore:queryLocator];
-        } @catch( NSException *e ) {
-            [[AccountUtil sharedAccountUtil] endNetworkAction];
-            [[AccountUtil sharedAccountUtil] receivedException:e];
+    // the next batch is fetched in the background while we merge this one
+    ZKQueryMoreEnumerator *batches = [[ZKQueryMoreEnumerator alloc] initWithClient:[[AccountUtil sharedAccountUtil] client]
+                                                                       queryLocator:queryLocator
+                                                                          lookahead:queryMoreLookahead];
+    
+    // the account lists only need a name and id per row, so keep them by column rather than as an sObject each
+    batches.recordBatches = YES;
+    
+    __block ZKCancellationToken *token = nil;
+    
+    token = [batches enumerateBatchesUsingBlock:^(ZKQueryResult *qr, BOOL *stop) {
+        if( [qr count] > 0 ) {
+            self.myRecords = [NSMutableDictionary dictionaryWithDictionary:
+                              [AccountUtil dictionaryByAddingAccounts:[qr records]
+                                                         toDictionary:self.myRecords]];
             
-            if( [self isEqual:[self.rootViewController currentSubNavViewController]] )
-                [DSBezelActivityView removeViewAnimated:YES];
+            storedSize += [qr count];
+            rowCountLabel.text = [NSString stringWithFormat:@"%i %@",
+                                  storedSize,
+                                  ( storedSize != 1 ? NSLocalizedString(@"Accounts", @"Account plural") : NSLocalizedString(@"Account", @"Account singular") )];
             
-            [(PullRefreshTableViewController *)self.pullRefreshTableViewController stopLoading];
+            [self.pullRefreshTableViewController.tableView reloadData];
+            [self.pullRefreshTableViewController.tableView setContentOffset:CGPointZero animated:NO];
             
-            return;
+            if( [self.detailViewController visibleAccountId] )
+                [self selectAccountWithId:[self.detailViewController visibleAccountId]];
         }
         
-        dispatch_async(dispatch_get_main_queue(), ^(void) {
-            [[AccountUtil sharedAccountUtil] endNetworkAction];
-            queryingMore = NO;
-            
-            if( qr && [qr records] && [[qr records] count] > 0 ) {
-                self.myRecords = [NSMutableDictionary dictionaryWithDictionary:
-                                  [AccountUtil dictionaryByAddingAccounts:[qr records]
-                                                             toDictionary:self.myRecords]];
-                
-                storedSize += [[qr records] count];
-                rowCountLabel.text = [NSString stringWithFormat:@"%i %@",
-                                      storedSize,
-                                      ( storedSize != 1 ? NSLocalizedString(@"Accounts", @"Account plural") : NSLocalizedString(@"Account", @"Account singular") )];
-                
-                [self.pullRefreshTableViewController.tableView reloadData];
-                [self.pullRefreshTableViewController.tableView setContentOffset:CGPointZero animated:NO];
-                
-                if( [self.detailViewController visibleAccountId] )
-                    [self selectAccountWithId:[self.detailViewController visibleAccountId]];
-                
-                if( [qr queryLocator] )
-                    [self queryMore:[qr queryLocator]];
-                else {
-                    NSLog(@"no more to query");
-                    if( [self isEqual:[self.rootViewController currentSubNavViewController]] )
-                        [DSBezelActivityView removeViewAnimated:YES];
-                }
-            } else if( [self isEqual:[self.rootViewController currentSubNavViewController]] )
-                [DSBezelActivityView removeViewAnimated:YES];
-        });
-    });
+        if( storedSize >= maxAccounts ) {
+            NSLog(@"stopping at %i accounts", storedSize);
+            *stop = YES;
+            [self cancelQueries];
+        }
+    } failBlock:^(NSException *e) {
+        if( ![self endQuery:token] )
+            return;
+        
+        queryingMore = NO;
+        [[AccountUtil sharedAccountUtil] endNetworkAction];
+        [[AccountUtil sharedAccountUtil] receivedException:e];
+        
+        if( [self isEqual:[self.rootViewController currentSubNavViewController]] )
+            [DSBezelActivityView removeViewAnimated:YES];
+        
+        [(PullRefreshTableViewController *)self.pullRefreshTableViewController stopLoading];
+    } completeBlock:^(void) {
+        if( ![self endQuery:token] )
+            return;
+        
+        queryingMore = NO;
+        [[AccountUtil sharedAccountUtil] endNetworkAction];
+        
+        NSLog(@"no more to query");
+        
+        if( [self isEqual:[self.rootViewController currentSubNavViewController]] )
+            [DSBezelActivityView removeViewAnimated:YES];
+    }];
+    
+    self.queryToken = token;
+    [batches release];
 }
 
 - (void)dealloc {
+    [queryToken cancel];
+    [queryToken release];
     [searchBar release];
     [searchResults release];
     [myRecords release];
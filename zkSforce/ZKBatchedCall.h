@@ -0,0 +1,56 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "zkSforceClient.h"
+
+// sends one batch, and calls exactly one of the blocks when it's done.
+typedef void (^zkSendBatchBlock)(NSArray *batch, zkFailWithExceptionBlock failBlock, zkCompleteArrayBlock completeBlock);
+
+// Splits a create/update/delete call into batches, and sends up to
+// concurrency of them at once. The results are put back together in the
+// same order as the items. A batch that fails gets a failed ZKSaveResult
+// for each of its items, so the caller can see which records didn't make
+// it, the call as a whole only fails if every batch did. For calls where
+// that doesn't make sense, like retrieve, set failOnAnyError.
+@interface ZKBatchedCall : NSObject {
+	NSArray				*items;
+	NSUInteger			batchSize, concurrency, batchCount;
+	zkSendBatchBlock	sendBlock;
+	NSMutableArray		*batchResults;	// one array of results per batch.
+	NSUInteger			nextBatch, outstanding, failures;
+	NSException			*firstError;
+	BOOL				finished;
+	BOOL				failOnAnyError;
+	dispatch_queue_t	stateQueue, queue;
+	ZKCancellationToken	*token;
+	zkFailWithExceptionBlock	failBlock;
+	zkCompleteArrayBlock		completeBlock;
+}
+
+- (id)initWithItems:(NSArray *)items batchSize:(NSUInteger)size concurrency:(NSUInteger)concurrency sendBlock:(zkSendBatchBlock)block;
+
+// the first batch to fail fails the whole call, and no more batches are sent. (defaults false)
+@property (assign) BOOL failOnAnyError;
+
+// the blocks are called on queue, unless the token is cancelled first.
+- (void)startWithToken:(ZKCancellationToken *)token queue:(dispatch_queue_t)queue failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock;
+
+@end
@@ -0,0 +1,145 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "ZKBatchedCall.h"
+#import "ZKCancellationToken.h"
+#import "zkSaveResult.h"
+
+@interface ZKBatchedCall ()
+- (void)sendMore;
+- (void)batch:(NSUInteger)b finished:(NSArray *)results;
+- (void)batch:(NSUInteger)b failed:(NSException *)ex;
+- (void)finishIfDone;
+@end
+
+@implementation ZKBatchedCall
+
+@synthesize failOnAnyError;
+
+- (id)initWithItems:(NSArray *)i batchSize:(NSUInteger)size concurrency:(NSUInteger)c sendBlock:(zkSendBatchBlock)block {
+	self = [super init];
+	items = [i retain];
+	batchSize = MAX(size, 1);
+	concurrency = MAX(c, 1);
+	sendBlock = [block copy];
+	batchCount = ([items count] + batchSize - 1) / batchSize;
+	batchResults = [[NSMutableArray alloc] initWithCapacity:batchCount];
+	for (NSUInteger b = 0; b < batchCount; b++)
+		[batchResults addObject:[NSNull null]];
+	stateQueue = dispatch_queue_create("com.pocketsoap.zksforce.batchedcall", NULL);
+	return self;
+}
+
+- (void)dealloc {
+	[items release];
+	[sendBlock release];
+	[batchResults release];
+	[firstError release];
+	[token release];
+	[failBlock release];
+	[completeBlock release];
+	dispatch_release(stateQueue);
+	if (queue != NULL) dispatch_release(queue);
+	[super dealloc];
+}
+
+// we don't need to hold onto ourselves, every request in flight is holding
+// onto a block that holds onto us, and if the token is cancelled, they all
+// let go, and so do we.
+- (void)startWithToken:(ZKCancellationToken *)t queue:(dispatch_queue_t)q failBlock:(zkFailWithExceptionBlock)fb completeBlock:(zkCompleteArrayBlock)cb {
+	token = [t retain];
+	queue = q;
+	dispatch_retain(queue);
+	failBlock = [fb copy];
+	completeBlock = [cb copy];
+	dispatch_async(stateQueue, ^(void) {
+		[self sendMore];
+		[self finishIfDone];
+	});
+}
+
+// these are all called on stateQueue, which looks after all the state.
+- (void)sendMore {
+	while (!finished && outstanding < concurrency && nextBatch < batchCount && ![token isCancelled]) {
+		NSUInteger b = nextBatch++;
+		NSUInteger start = b * batchSize;
+		NSArray *batch = [items subarrayWithRange:NSMakeRange(start, MIN(batchSize, [items count] - start))];
+		outstanding++;
+		sendBlock(batch, ^(NSException *ex) {
+			dispatch_async(stateQueue, ^(void) {
+				[self batch:b failed:ex];
+			});
+		}, ^(NSArray *results) {
+			dispatch_async(stateQueue, ^(void) {
+				[self batch:b finished:results];
+			});
+		});
+	}
+}
+
+- (void)batch:(NSUInteger)b finished:(NSArray *)results {
+	outstanding--;
+	[batchResults replaceObjectAtIndex:b withObject:results != nil ? results : [NSArray array]];
+	[self sendMore];
+	[self finishIfDone];
+}
+
+- (void)batch:(NSUInteger)b failed:(NSException *)ex {
+	outstanding--;
+	failures++;
+	if (firstError == nil)
+		firstError = [ex retain];
+	if (failOnAnyError) {
+		if (finished) return;
+		finished = YES;
+		dispatch_async(queue, ^(void) {
+			if (![token isCancelled])
+				failBlock(ex);
+		});
+		return;
+	}
+	NSUInteger count = MIN(batchSize, [items count] - b * batchSize);
+	ZKSaveResult *failed = [ZKSaveResult failedResultWithException:ex];
+	NSMutableArray *results = [NSMutableArray arrayWithCapacity:count];
+	for (NSUInteger i = 0; i < count; i++)
+		[results addObject:failed];
+	[batchResults replaceObjectAtIndex:b withObject:results];
+	[self sendMore];
+	[self finishIfDone];
+}
+
+- (void)finishIfDone {
+	if (finished || outstanding > 0 || nextBatch < batchCount || [token isCancelled]) return;
+	finished = YES;
+	NSMutableArray *results = [NSMutableArray arrayWithCapacity:[items count]];
+	for (NSArray *r in batchResults)
+		[results addObjectsFromArray:r];
+	BOOL allFailed = batchCount > 0 && failures == batchCount;
+	dispatch_async(queue, ^(void) {
+		if ([token isCancelled]) return;
+		if (allFailed)
+			failBlock(firstError);
+		else
+			completeBlock(results);
+	});
+}
+
+@end
@@ -0,0 +1,49 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Returned by the async ZKSforceClient/ZKBaseClient calls, cancel stops the
+// call wherever it's got to, a queued request is dropped, an in flight
+// connection is closed, and any parse in progress is stopped. Once a call
+// has been cancelled on the main thread, neither its fail nor complete block
+// will be called.
+@interface ZKCancellationToken : NSObject {
+	BOOL			cancelled;
+	NSMutableArray	*handlers;
+}
+
++ (ZKCancellationToken *)token;
+
+- (void)cancel;
+- (BOOL)isCancelled;
+
+// the block is called (on the thread that calls cancel) when the token is
+// cancelled, or straight away if it already has been. The return value can be
+// passed to removeCancelHandler:, it's nil if the handler has already run.
+- (id)addCancelHandler:(void (^)(void))handler;
+
+// drops a handler without running it, for once whatever it'd stop has finished
+// by itself, so that a long lived token doesn't collect them.
+- (void)removeCancelHandler:(id)handler;
+
+// drops the handlers without running them, for once whatever they'd stop has finished by itself.
+- (void)removeAllCancelHandlers;
+
+@end
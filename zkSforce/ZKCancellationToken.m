@@ -0,0 +1,87 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "ZKCancellationToken.h"
+
+@implementation ZKCancellationToken
+
++ (ZKCancellationToken *)token {
+	return [[[ZKCancellationToken alloc] init] autorelease];
+}
+
+- (id)init {
+	self = [super init];
+	handlers = [[NSMutableArray alloc] init];
+	return self;
+}
+
+- (void)dealloc {
+	[handlers release];
+	[super dealloc];
+}
+
+- (void)cancel {
+	NSArray *toRun = nil;
+	@synchronized (self) {
+		if (cancelled) return;
+		cancelled = YES;
+		toRun = [[handlers retain] autorelease];
+		// the handlers tend to hold onto requests and parsers, don't keep them around once they've run.
+		[handlers release];
+		handlers = nil;
+	}
+	for (void (^handler)(void) in toRun)
+		handler();
+}
+
+- (BOOL)isCancelled {
+	@synchronized (self) {
+		return cancelled;
+	}
+}
+
+- (id)addCancelHandler:(void (^)(void))handler {
+	@synchronized (self) {
+		if (!cancelled) {
+			void (^h)(void) = [handler copy];
+			[handlers addObject:h];
+			[h release];
+			return h;
+		}
+	}
+	handler();
+	return nil;
+}
+
+- (void)removeCancelHandler:(id)handler {
+	if (handler == nil) return;
+	@synchronized (self) {
+		[handlers removeObjectIdenticalTo:handler];
+	}
+}
+
+- (void)removeAllCancelHandlers {
+	@synchronized (self) {
+		[handlers removeAllObjects];
+	}
+}
+
+@end
@@ -0,0 +1,52 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Parsing and formatting of xsd:dateTime and xsd:date values, as used by the
+// API, e.g. 2011-01-24T17:34:14.000Z and 2011-01-24.
+//
+// Unlike NSDateFormatter, these don't allocate anything while parsing, and
+// don't keep any state, so they're safe to call from any thread at once.
+
+// parses an xsd:dateTime, if there's no timezone it's taken to be GMT. returns NO if it's not a dateTime.
+BOOL ZKParseDateTime(const char *s, size_t len, CFAbsoluteTime *result);
+
+// parses an xsd:date, the result is midnight at the start of that day in the given timezone, or GMT if tz is NULL.
+BOOL ZKParseDate(const char *s, size_t len, CFTimeZoneRef tz, CFAbsoluteTime *result);
+
+// writes the dateTime in GMT, e.g. 2011-01-24T17:34:14.000Z, buf should have room for at least 25 chars, returns the length.
+size_t ZKFormatDateTime(CFAbsoluteTime t, char *buf);
+
+// writes the day that t falls on in the given timezone (or GMT if NULL), e.g. 2011-01-24, buf should have room for at least 11 chars.
+size_t ZKFormatDate(CFAbsoluteTime t, CFTimeZoneRef tz, char *buf);
+
+@interface ZKDateTime : NSObject {
+}
+
+// nil if the string isn't a dateTime.
++ (NSDate *)dateFromDateTimeString:(NSString *)dateTime;
++ (NSString *)dateTimeStringFromDate:(NSDate *)date;
+
+// dates are midnight at the start of the day in the local timezone, which is what
+// NSDateFormatter would give you, so they display as the right day.
++ (NSDate *)dateFromDateString:(NSString *)date;
++ (NSString *)dateStringFromDate:(NSDate *)date;
+
+@end
@@ -0,0 +1,225 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "ZKDateTime.h"
+
+// days between 1970-01-01 and the given day of the proleptic gregorian calendar.
+static long daysFromCivil(long y, unsigned m, unsigned d) {
+	y -= m <= 2;
+	long era = (y >= 0 ? y : y - 399) / 400;
+	unsigned yoe = (unsigned)(y - era * 400);
+	unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + (long)doe - 719468;
+}
+
+// the reverse of daysFromCivil.
+static void civilFromDays(long z, long *y, unsigned *m, unsigned *d) {
+	z += 719468;
+	long era = (z >= 0 ? z : z - 146096) / 146097;
+	unsigned doe = (unsigned)(z - era * 146097);
+	unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	unsigned mp = (5 * doy + 2) / 153;
+	*d = doy - (153 * mp + 2) / 5 + 1;
+	*m = mp < 10 ? mp + 3 : mp - 9;
+	*y = (long)yoe + era * 400 + (*m <= 2);
+}
+
+// reads exactly n digits, returns -1 if they're not all there.
+static int digits(const char *s, const char *end, int n) {
+	if (end - s < n) return -1;
+	int v = 0;
+	for (int i = 0; i < n; i++) {
+		if (s[i] < '0' || s[i] > '9') return -1;
+		v = v * 10 + (s[i] - '0');
+	}
+	return v;
+}
+
+static void writeDigits(char *buf, long v, int n) {
+	for (int i = n - 1; i >= 0; i--) {
+		buf[i] = '0' + (v % 10);
+		v /= 10;
+	}
+}
+
+static const CFAbsoluteTime SECS_PER_DAY = 86400;
+
+// yyyy-MM-dd, returns the days since 1970-01-01, and moves s past it.
+static BOOL parseDay(const char **s, const char *end, long *days) {
+	const char *p = *s;
+	int y = digits(p, end, 4);
+	if (y < 0 || end - p < 10 || p[4] != '-' || p[7] != '-') return NO;
+	int m = digits(p + 5, end, 2);
+	int d = digits(p + 8, end, 2);
+	if (m < 1 || m > 12 || d < 1 || d > 31) return NO;
+	*days = daysFromCivil(y, m, d);
+	*s = p + 10;
+	return YES;
+}
+
+static CFAbsoluteTime absoluteTimeFromDays(long days) {
+	return days * SECS_PER_DAY - kCFAbsoluteTimeIntervalSince1970;
+}
+
+BOOL ZKParseDateTime(const char *s, size_t len, CFAbsoluteTime *result) {
+	const char *end = s + len;
+	long days;
+	if (!parseDay(&s, end, &days)) return NO;
+	if (end - s < 9 || s[0] != 'T' || s[3] != ':' || s[6] != ':') return NO;
+	int h = digits(s + 1, end, 2);
+	int mi = digits(s + 4, end, 2);
+	int sec = digits(s + 7, end, 2);
+	if (h < 0 || h > 24 || mi < 0 || mi > 59 || sec < 0 || sec > 60) return NO;
+	s += 9;
+	double frac = 0, scale = 0.1;
+	if (s < end && *s == '.') {
+		for (s++; s < end && *s >= '0' && *s <= '9'; s++, scale /= 10)
+			frac += (*s - '0') * scale;
+	}
+	int offset = 0;
+	if (s < end && *s == 'Z') {
+		s++;
+	} else if (s < end && (*s == '+' || *s == '-')) {
+		int oh = digits(s + 1, end, 2);
+		if (oh < 0 || end - s < 6 || s[3] != ':') return NO;
+		int om = digits(s + 4, end, 2);
+		if (om < 0) return NO;
+		offset = (oh * 60 + om) * 60 * (*s == '-' ? -1 : 1);
+		s += 6;
+	}
+	if (s != end) return NO;
+	*result = absoluteTimeFromDays(days) + h * 3600 + mi * 60 + sec + frac - offset;
+	return YES;
+}
+
+BOOL ZKParseDate(const char *s, size_t len, CFTimeZoneRef tz, CFAbsoluteTime *result) {
+	const char *end = s + len;
+	long days;
+	if (!parseDay(&s, end, &days) || s != end) return NO;
+	CFAbsoluteTime t = absoluteTimeFromDays(days);
+	if (tz != NULL) {
+		// the offset at midnight GMT is good enough to find local midnight, unless it's a DST changeover, so check again.
+		CFAbsoluteTime local = t - CFTimeZoneGetSecondsFromGMT(tz, t);
+		t -= CFTimeZoneGetSecondsFromGMT(tz, local);
+	}
+	*result = t;
+	return YES;
+}
+
+static size_t formatDay(long days, char *buf) {
+	long y;
+	unsigned m, d;
+	civilFromDays(days, &y, &m, &d);
+	writeDigits(buf, y, 4);
+	buf[4] = '-';
+	writeDigits(buf + 5, m, 2);
+	buf[7] = '-';
+	writeDigits(buf + 8, d, 2);
+	return 10;
+}
+
+size_t ZKFormatDateTime(CFAbsoluteTime t, char *buf) {
+	long long ms = llround((t + kCFAbsoluteTimeIntervalSince1970) * 1000);
+	long long msPerDay = (long long)SECS_PER_DAY * 1000;
+	long days = (long)(ms >= 0 ? ms / msPerDay : (ms - msPerDay + 1) / msPerDay);
+	long msOfDay = (long)(ms - (long long)days * msPerDay);
+	size_t len = formatDay(days, buf);
+	buf[len++] = 'T';
+	writeDigits(buf + len, msOfDay / 3600000, 2);
+	buf[len + 2] = ':';
+	writeDigits(buf + len + 3, (msOfDay / 60000) % 60, 2);
+	buf[len + 5] = ':';
+	writeDigits(buf + len + 6, (msOfDay / 1000) % 60, 2);
+	buf[len + 8] = '.';
+	writeDigits(buf + len + 9, msOfDay % 1000, 3);
+	buf[len + 12] = 'Z';
+	len += 13;
+	buf[len] = 0;
+	return len;
+}
+
+size_t ZKFormatDate(CFAbsoluteTime t, CFTimeZoneRef tz, char *buf) {
+	if (tz != NULL)
+		t += CFTimeZoneGetSecondsFromGMT(tz, t);
+	double secs = t + kCFAbsoluteTimeIntervalSince1970;
+	size_t len = formatDay((long)floor(secs / SECS_PER_DAY), buf);
+	buf[len] = 0;
+	return len;
+}
+
+// a fast path for the common case where the string's bytes can be read in place.
+static const char *asciiBytes(NSString *s, char *buf, size_t bufLen, size_t *len) {
+	const char *p = CFStringGetCStringPtr((CFStringRef)s, kCFStringEncodingASCII);
+	if (p == NULL) {
+		p = CFStringGetCStringPtr((CFStringRef)s, kCFStringEncodingUTF8);
+	}
+	if (p == NULL) {
+		if (!CFStringGetCString((CFStringRef)s, buf, bufLen, kCFStringEncodingASCII))
+			return NULL;
+		p = buf;
+	}
+	*len = strlen(p);
+	return p;
+}
+
+@implementation ZKDateTime
+
++ (NSDate *)dateFromDateTimeString:(NSString *)dateTime {
+	if (dateTime == nil) return nil;
+	char buf[64];
+	size_t len;
+	const char *p = asciiBytes(dateTime, buf, sizeof(buf), &len);
+	CFAbsoluteTime t;
+	if (p == NULL || !ZKParseDateTime(p, len, &t)) return nil;
+	return [NSDate dateWithTimeIntervalSinceReferenceDate:t];
+}
+
++ (NSString *)dateTimeStringFromDate:(NSDate *)date {
+	if (date == nil) return nil;
+	char buf[32];
+	size_t len = ZKFormatDateTime([date timeIntervalSinceReferenceDate], buf);
+	return [[[NSString alloc] initWithBytes:buf length:len encoding:NSASCIIStringEncoding] autorelease];
+}
+
++ (NSDate *)dateFromDateString:(NSString *)date {
+	if (date == nil) return nil;
+	char buf[32];
+	size_t len;
+	const char *p = asciiBytes(date, buf, sizeof(buf), &len);
+	CFAbsoluteTime t;
+	CFTimeZoneRef tz = CFTimeZoneCopyDefault();
+	BOOL ok = p != NULL && ZKParseDate(p, len, tz, &t);
+	CFRelease(tz);
+	return ok ? [NSDate dateWithTimeIntervalSinceReferenceDate:t] : nil;
+}
+
++ (NSString *)dateStringFromDate:(NSDate *)date {
+	if (date == nil) return nil;
+	char buf[16];
+	CFTimeZoneRef tz = CFTimeZoneCopyDefault();
+	size_t len = ZKFormatDate([date timeIntervalSinceReferenceDate], tz, buf);
+	CFRelease(tz);
+	return [[[NSString alloc] initWithBytes:buf length:len encoding:NSASCIIStringEncoding] autorelease];
+}
+
+@end
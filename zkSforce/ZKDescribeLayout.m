@@ -71,8 +71,17 @@ for ( ZKDescribeLayout *layout in layouts ) {
 
 
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "id", zkXmlString },
+	{ NULL, 0 }
+};
+
 @implementation ZKDescribeLayout
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
 -(void)dealloc {
 	[buttonLayoutSection release];
 	[detailLayoutSections release];
@@ -113,4 +122,12 @@ for ( ZKDescribeLayout *layout in layouts ) {
 	return relatedLists;	
 }
 
+- (void)detach {
+	[[self buttonLayoutSection] detach];
+	[[self detailLayoutSections] makeObjectsPerformSelector:@selector(detach)];
+	[[self editLayoutSections] makeObjectsPerformSelector:@selector(detach)];
+	[[self relatedLists] makeObjectsPerformSelector:@selector(detach)];
+	[super detach];
+}
+
 @end
\ No newline at end of file
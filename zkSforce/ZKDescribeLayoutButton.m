@@ -23,8 +23,19 @@
 #import "ZKDescribeLayoutButton.h"
 
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "custom", zkXmlBoolean },
+	{ "label",  zkXmlString },
+	{ "name",   zkXmlString },
+	{ NULL, 0 }
+};
+
 @implementation ZKDescribeLayoutButton
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
 -(BOOL)custom {
 	return [self boolean:@"custom"];
 }
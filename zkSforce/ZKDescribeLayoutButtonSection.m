@@ -36,4 +36,9 @@
 	return detailButtons;
 }
 
+- (void)detach {
+	[[self detailButtons] makeObjectsPerformSelector:@selector(detach)];
+	[super detach];
+}
+
 @end
\ No newline at end of file
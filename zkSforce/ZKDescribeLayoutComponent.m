@@ -21,8 +21,20 @@
 
 #import "ZKDescribeLayoutComponent.h"
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "value",        zkXmlString },
+	{ "type",         zkXmlSymbol },
+	{ "tabOrder",     zkXmlInteger },
+	{ "displayLines", zkXmlInteger },
+	{ NULL, 0 }
+};
+
 @implementation ZKDescribeLayoutComponent
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
 - (id)initWithXmlElement:(zkElement *)e {
 	self = [super initWithXmlElement:e];
 	compType = zkComponentTypeUnknown;
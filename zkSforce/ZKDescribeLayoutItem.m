@@ -24,8 +24,20 @@
 #import "ZKParser.h"
 
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "editable",    zkXmlBoolean },
+	{ "placeholder", zkXmlBoolean },
+	{ "required",    zkXmlBoolean },
+	{ "label",       zkXmlString },
+	{ NULL, 0 }
+};
+
 @implementation ZKDescribeLayoutItem
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
 -(void)dealloc  {
 	[layoutComponents release];
 	[super dealloc];
@@ -53,4 +65,9 @@
 	return layoutComponents;
 }
 
+- (void)detach {
+	[[self layoutComponents] makeObjectsPerformSelector:@selector(detach)];
+	[super detach];
+}
+
 @end
\ No newline at end of file
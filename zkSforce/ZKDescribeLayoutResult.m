@@ -25,8 +25,17 @@
 #import "ZKDescribeLayout.h"
 #import "ZKParser.h" 
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "recordTypeSelectorRequired", zkXmlBoolean },
+	{ NULL, 0 }
+};
+
 @implementation ZKDescribeLayoutResult 
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
 - (void)dealloc  {
 	[recordTypeMappings release];
 	[layouts release];
@@ -48,5 +57,11 @@
 		layouts = [[self complexTypeArrayFromElements:@"layouts" cls:[ZKDescribeLayout class]] retain];
 	return layouts;	
 }
+- (void)detach {
+	[[self recordTypeMappings] makeObjectsPerformSelector:@selector(detach)];
+	[[self layouts] makeObjectsPerformSelector:@selector(detach)];
+	[super detach];
+}
+
 @end
 
@@ -24,8 +24,17 @@
 #import "ZKDescribeLayoutRow.h"
 #import "ZKParser.h"
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "numItems", zkXmlInteger },
+	{ NULL, 0 }
+};
+
 @implementation ZKDescribeLayoutRow
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
 -(void)dealloc {
 	[layoutItems release];
 	[super dealloc];
@@ -41,4 +50,9 @@
 	return layoutItems;
 }
 
+- (void)detach {
+	[[self layoutItems] makeObjectsPerformSelector:@selector(detach)];
+	[super detach];
+}
+
 @end
\ No newline at end of file
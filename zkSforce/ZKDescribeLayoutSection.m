@@ -25,8 +25,22 @@
 #import "ZKParser.h"
 
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "useCollapsibleSection", zkXmlBoolean },
+	{ "useHeading",            zkXmlBoolean },
+	{ "recordTypeId",          zkXmlString },
+	{ "heading",               zkXmlString },
+	{ "columns",               zkXmlInteger },
+	{ "rows",                  zkXmlInteger },
+	{ NULL, 0 }
+};
+
 @implementation ZKDescribeLayoutSection 
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
 -(void)dealloc {
 	[layoutRows release];
 	[super dealloc];
@@ -62,4 +76,9 @@
 	return layoutRows;
 }
 
+- (void)detach {
+	[[self layoutRows] makeObjectsPerformSelector:@selector(detach)];
+	[super detach];
+}
+
 @end
\ No newline at end of file
@@ -0,0 +1,46 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// gzip support for the SOAP transport, ZKBaseClient uses these when
+// request/response compression is turned on.
+@interface ZKGzip : NSObject {
+}
+// returns a gzip'd copy of data.
++ (NSData *)gzipData:(NSData *)data;
+
+// returns YES if data starts with the gzip magic number.
++ (BOOL)isGzipData:(NSData *)data;
+
+// inflates a complete gzip'd buffer in one go.
++ (NSData *)gunzipData:(NSData *)data;
+@end
+
+// Incremental gzip decoder, feed it the compressed bytes as they arrive from
+// the network and it hands back whatever can be decompressed so far, so the
+// response never has to be held compressed and decompressed at the same time.
+@interface ZKGzipInflater : NSObject {
+	void	*stream;
+	BOOL	finished;
+}
+// returns the bytes decompressed from this chunk, throws if the data isn't valid gzip.
+- (NSData *)inflate:(NSData *)chunk;
+- (BOOL)finished;
+@end
@@ -0,0 +1,105 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "ZKGzip.h"
+#include <zlib.h>
+
+static const int INFLATE_CHUNK_SIZE = 32 * 1024;
+
+@implementation ZKGzip
+
++ (NSData *)gzipData:(NSData *)data {
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	// 15 bits of window, +16 to get a gzip header & trailer rather than zlib's.
+	if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		@throw [NSException exceptionWithName:@"Compression error" reason:@"Unable to initialize zlib deflate" userInfo:nil];
+	NSMutableData *out = [NSMutableData dataWithLength:deflateBound(&zs, [data length])];
+	zs.next_in = (Bytef *)[data bytes];
+	zs.avail_in = (uInt)[data length];
+	zs.next_out = [out mutableBytes];
+	zs.avail_out = (uInt)[out length];
+	int r = deflate(&zs, Z_FINISH);
+	deflateEnd(&zs);
+	if (r != Z_STREAM_END)
+		@throw [NSException exceptionWithName:@"Compression error" reason:[NSString stringWithFormat:@"zlib deflate failed with %d", r] userInfo:nil];
+	[out setLength:zs.total_out];
+	return out;
+}
+
++ (BOOL)isGzipData:(NSData *)data {
+	if ([data length] < 2) return NO;
+	const unsigned char *b = [data bytes];
+	return b[0] == 0x1f && b[1] == 0x8b;
+}
+
++ (NSData *)gunzipData:(NSData *)data {
+	ZKGzipInflater *i = [[[ZKGzipInflater alloc] init] autorelease];
+	return [i inflate:data];
+}
+
+@end
+
+@implementation ZKGzipInflater
+
+- (id)init {
+	self = [super init];
+	z_stream *zs = calloc(1, sizeof(z_stream));
+	if (inflateInit2(zs, 15 + 16) != Z_OK) {
+		free(zs);
+		[self release];
+		@throw [NSException exceptionWithName:@"Compression error" reason:@"Unable to initialize zlib inflate" userInfo:nil];
+	}
+	stream = zs;
+	return self;
+}
+
+- (void)dealloc {
+	inflateEnd((z_stream *)stream);
+	free(stream);
+	[super dealloc];
+}
+
+- (BOOL)finished {
+	return finished;
+}
+
+- (NSData *)inflate:(NSData *)chunk {
+	z_stream *zs = (z_stream *)stream;
+	NSMutableData *out = [NSMutableData dataWithCapacity:[chunk length] * 4];
+	unsigned char buff[INFLATE_CHUNK_SIZE];
+	zs->next_in = (Bytef *)[chunk bytes];
+	zs->avail_in = (uInt)[chunk length];
+	// keep going while there's input left, or the last pass filled the buffer (so there may be more output pending)
+	do {
+		zs->next_out = buff;
+		zs->avail_out = sizeof(buff);
+		int r = inflate(zs, Z_NO_FLUSH);
+		if (r != Z_OK && r != Z_STREAM_END && r != Z_BUF_ERROR)
+			@throw [NSException exceptionWithName:@"Compression error" reason:[NSString stringWithFormat:@"zlib inflate failed with %d", r] userInfo:nil];
+		[out appendBytes:buff length:sizeof(buff) - zs->avail_out];
+		if (r == Z_STREAM_END) finished = YES;
+		if (r == Z_BUF_ERROR) break;	// no progress possible until we get more input
+	} while (!finished && (zs->avail_in > 0 || zs->avail_out == 0));
+	return out;
+}
+
+@end
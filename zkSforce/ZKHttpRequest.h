@@ -0,0 +1,82 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+@class ZKHttpRequest;
+@class ZKGzipInflater;
+
+typedef void (^ZKHttpCompletionBlock)(ZKHttpRequest *request, NSError *error);
+typedef void (^ZKHttpDataBlock)(ZKHttpRequest *request, NSData *data);
+
+// A single non-blocking HTTP request. All requests go through the shared
+// ZKHttpTransport, and are serviced from its network thread, so any number
+// of them can be in flight without tying up a thread each. The completion block is called on a background
+// queue once the whole response has been read. If the response body
+// arrives gzip'd it's decompressed as each chunk is read. If a data block
+// is set, each (decompressed) chunk is passed to it on the network thread
+// as it arrives instead of being collected into responseData.
+@interface ZKHttpRequest : NSObject {
+	NSURLRequest			*request;
+	NSURLConnection			*connection;
+	NSHTTPURLResponse		*response;
+	NSMutableData			*responseData;
+	ZKGzipInflater			*inflater;
+	NSUInteger				bytesReceived;
+	ZKHttpCompletionBlock	completionBlock;
+	ZKHttpDataBlock			dataBlock;
+	void					(^finishedBlock)(void);
+	CFAbsoluteTime			queuedAt, startedAt, firstByteAt, finishedAt;
+	BOOL					finished;
+	volatile BOOL			cancelled;
+}
+
++ (id)requestWithURLRequest:(NSURLRequest *)req completionBlock:(ZKHttpCompletionBlock)block;
+
+- (id)initWithURLRequest:(NSURLRequest *)req completionBlock:(ZKHttpCompletionBlock)block;
+
+// hands the request to the shared transport, which starts it once there's a free slot for its host.
+- (void)start;
+
+// called by the transport on its network thread, the block is called there once the connection is done with.
+- (void)startConnectionWithCompletion:(void (^)(void))block;
+
+// drops the request if it's still queued, or closes its connection if it's
+// started, the completion block is still called, with an NSURLErrorCancelled
+// error, check isCancelled to tell a cancel apart from the connection failing.
+- (void)cancel;
+- (BOOL)isCancelled;
+
+// called by the transport on its network thread once it's no longer queued.
+- (void)cancelConnection;
+
+@property (copy) ZKHttpDataBlock dataBlock;	// set this before calling start.
+@property (readonly) NSURLRequest *request;
+@property (readonly) NSHTTPURLResponse *response;
+@property (readonly) NSData *responseData;	// the decompressed response body.
+@property (readonly) NSUInteger bytesReceived;	// the number of body bytes read from the network.
+
+// when the request was handed to the transport, when its connection was
+// started, when the first body byte arrived, and when it finished.
+@property (readonly) CFAbsoluteTime queuedAt;
+@property (readonly) CFAbsoluteTime startedAt;
+@property (readonly) CFAbsoluteTime firstByteAt;
+@property (readonly) CFAbsoluteTime finishedAt;
+
+@end
@@ -0,0 +1,171 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "ZKHttpRequest.h"
+#import "ZKGzip.h"
+#import "ZKHttpTransport.h"
+
+@interface ZKHttpRequest ()
+- (void)receivedData:(NSData *)data;
+- (void)finishWithError:(NSError *)err;
+@end
+
+@implementation ZKHttpRequest
+
+@synthesize request, response, bytesReceived, dataBlock;
+@synthesize queuedAt, startedAt, firstByteAt, finishedAt;
+
++ (id)requestWithURLRequest:(NSURLRequest *)req completionBlock:(ZKHttpCompletionBlock)block {
+	return [[[ZKHttpRequest alloc] initWithURLRequest:req completionBlock:block] autorelease];
+}
+
+- (id)initWithURLRequest:(NSURLRequest *)req completionBlock:(ZKHttpCompletionBlock)block {
+	self = [super init];
+	request = [req copy];
+	completionBlock = [block copy];
+	return self;
+}
+
+- (void)dealloc {
+	[request release];
+	[connection release];
+	[response release];
+	[responseData release];
+	[inflater release];
+	[completionBlock release];
+	[dataBlock release];
+	[finishedBlock release];
+	[super dealloc];
+}
+
+- (NSData *)responseData {
+	return responseData;
+}
+
+- (void)start {
+	queuedAt = CFAbsoluteTimeGetCurrent();
+	[[ZKHttpTransport sharedTransport] startRequest:self];
+}
+
+- (void)startConnectionWithCompletion:(void (^)(void))block {
+	finishedBlock = [block copy];
+	startedAt = CFAbsoluteTimeGetCurrent();
+	// ask for the connection to be kept open, so that the transport can reuse it for the next request to this host.
+	NSMutableURLRequest *req = [[request mutableCopy] autorelease];
+	[req setValue:@"keep-alive" forHTTPHeaderField:@"Connection"];
+	connection = [[NSURLConnection alloc] initWithRequest:req delegate:self startImmediately:NO];
+	[connection scheduleInRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+	[connection start];
+}
+
+- (void)cancel {
+	cancelled = YES;
+	[[ZKHttpTransport sharedTransport] cancelRequest:self];
+}
+
+- (BOOL)isCancelled {
+	return cancelled;
+}
+
+- (void)cancelConnection {
+	if (finished) return;
+	[connection cancel];
+	[self finishWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil]];
+}
+
+- (void)finishWithError:(NSError *)err {
+	if (finished) return;
+	finished = YES;
+	finishedAt = CFAbsoluteTimeGetCurrent();
+	if (firstByteAt == 0)
+		firstByteAt = finishedAt;
+	[connection release];
+	connection = nil;
+	// let the transport know the slot is free.
+	if (finishedBlock != nil) {
+		finishedBlock();
+		[finishedBlock release];
+		finishedBlock = nil;
+	}
+	// nothing else is going to arrive, and the data block may be holding onto things that are holding onto us.
+	[dataBlock release];
+	dataBlock = nil;
+	// don't do any real work on the network thread, it'd hold up every other request.
+	[self retain];
+	dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(void) {
+		completionBlock(self, err);
+		[completionBlock release];
+		completionBlock = nil;
+		[self release];
+	});
+}
+
+#pragma mark NSURLConnection delegate
+
+- (void)connection:(NSURLConnection *)c didReceiveResponse:(NSURLResponse *)resp {
+	[response release];
+	response = [(NSHTTPURLResponse *)resp retain];
+	long long len = [resp expectedContentLength];
+	[responseData release];
+	responseData = dataBlock == nil ? [[NSMutableData alloc] initWithCapacity:len > 0 ? (NSUInteger)len : 4096] : nil;
+}
+
+- (void)receivedData:(NSData *)data {
+	if (dataBlock != nil)
+		dataBlock(self, data);
+	else
+		[responseData appendData:data];
+}
+
+- (void)connection:(NSURLConnection *)c didReceiveData:(NSData *)data {
+	// NSURLConnection normally decompresses for us, but if the body is still gzip'd, we do it here.
+	if (bytesReceived == 0) {
+		firstByteAt = CFAbsoluteTimeGetCurrent();
+		if ([ZKGzip isGzipData:data])
+			inflater = [[ZKGzipInflater alloc] init];
+	}
+	bytesReceived += [data length];
+	if (inflater == nil) {
+		[self receivedData:data];
+		return;
+	}
+	@try {
+		[self receivedData:[inflater inflate:data]];
+	} @catch (NSException *ex) {
+		[connection cancel];
+		[self finishWithError:[NSError errorWithDomain:@"ZKGzip" code:-1 userInfo:[NSDictionary dictionaryWithObject:[ex reason] forKey:NSLocalizedDescriptionKey]]];
+	}
+}
+
+- (void)connectionDidFinishLoading:(NSURLConnection *)c {
+	[self finishWithError:nil];
+}
+
+- (void)connection:(NSURLConnection *)c didFailWithError:(NSError *)error {
+	[self finishWithError:error];
+}
+
+// we don't want NSURLConnection keeping copies of SOAP responses around.
+- (NSCachedURLResponse *)connection:(NSURLConnection *)c willCacheResponse:(NSCachedURLResponse *)cachedResponse {
+	return nil;
+}
+
+@end
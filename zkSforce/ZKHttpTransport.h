@@ -0,0 +1,54 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+@class ZKHttpRequest;
+
+// The shared transport that all ZKHttpRequests go through. It owns the
+// network thread that their connections are scheduled on, and limits how
+// many requests can be in flight to any one host, requests over the limit
+// wait in a FIFO queue until an earlier one for that host finishes.
+// Keeping the number of concurrent requests small lets the connections
+// CFNetwork keeps alive be reused, rather than each extra request paying
+// for a new TCP connection and TLS handshake.
+@interface ZKHttpTransport : NSObject {
+	NSUInteger			maxConcurrentRequestsPerHost;
+	NSMutableDictionary	*activeCounts;		// host -> NSNumber
+	NSMutableDictionary	*pending;			// host -> NSMutableArray of ZKHttpRequest
+}
+
++ (ZKHttpTransport *)sharedTransport;
+
+// the thread that all the connections are run from.
++ (NSThread *)networkThread;
+
+// defaults to 4, can be changed at any time.
+@property (assign) NSUInteger maxConcurrentRequestsPerHost;
+
+// starts the request now, or queues it if its host is already at the limit.
+- (void)startRequest:(ZKHttpRequest *)request;
+
+// removes the request from the queue if it's still waiting, or stops its connection if not.
+- (void)cancelRequest:(ZKHttpRequest *)request;
+
+// the number of requests waiting for a free slot, across all hosts.
+- (NSUInteger)queuedRequestCount;
+
+@end
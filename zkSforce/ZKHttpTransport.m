@@ -0,0 +1,175 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "ZKHttpTransport.h"
+#import "ZKHttpRequest.h"
+
+static const NSUInteger DEFAULT_MAX_CONCURRENT_REQUESTS_PER_HOST = 4;
+
+// all the bookkeeping happens on the network thread, so it doesn't need any locking.
+@interface ZKHttpTransport ()
+- (void)enqueueOnNetworkThread:(ZKHttpRequest *)request;
+- (void)startPendingRequests:(NSString *)host;
+- (void)startAllPendingRequests;
+- (void)countPending:(NSMutableArray *)result;
+- (void)cancelOnNetworkThread:(ZKHttpRequest *)request;
+@end
+
+@implementation ZKHttpTransport
+
+// NSURLConnection needs a runloop to deliver its delegate callbacks on, rather
+// than parking a thread per request, we have one thread that all requests share.
++ (void)networkThreadMain:(id)unused {
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	NSRunLoop *rl = [NSRunLoop currentRunLoop];
+	// a runloop with no sources exits straight away, so give it a port to watch.
+	[rl addPort:[NSMachPort port] forMode:NSDefaultRunLoopMode];
+	[pool release];
+	while (YES) {
+		pool = [[NSAutoreleasePool alloc] init];
+		[rl runMode:NSDefaultRunLoopMode beforeDate:[NSDate distantFuture]];
+		[pool release];
+	}
+}
+
++ (NSThread *)networkThread {
+	static NSThread *thread = nil;
+	static dispatch_once_t once;
+	dispatch_once(&once, ^{
+		thread = [[NSThread alloc] initWithTarget:self selector:@selector(networkThreadMain:) object:nil];
+		[thread setName:@"zkSforce network"];
+		[thread start];
+	});
+	return thread;
+}
+
++ (ZKHttpTransport *)sharedTransport {
+	static ZKHttpTransport *transport = nil;
+	static dispatch_once_t once;
+	dispatch_once(&once, ^{
+		transport = [[ZKHttpTransport alloc] init];
+	});
+	return transport;
+}
+
+- (id)init {
+	self = [super init];
+	maxConcurrentRequestsPerHost = DEFAULT_MAX_CONCURRENT_REQUESTS_PER_HOST;
+	activeCounts = [[NSMutableDictionary alloc] init];
+	pending = [[NSMutableDictionary alloc] init];
+	return self;
+}
+
+- (void)dealloc {
+	[activeCounts release];
+	[pending release];
+	[super dealloc];
+}
+
+- (NSUInteger)maxConcurrentRequestsPerHost {
+	@synchronized (self) {
+		return maxConcurrentRequestsPerHost;
+	}
+}
+
+- (void)setMaxConcurrentRequestsPerHost:(NSUInteger)max {
+	@synchronized (self) {
+		maxConcurrentRequestsPerHost = max > 0 ? max : 1;
+	}
+	// if the limit went up, some of the queued requests can go now.
+	[self performSelector:@selector(startAllPendingRequests) onThread:[ZKHttpTransport networkThread] withObject:nil waitUntilDone:NO];
+}
+
+- (void)startRequest:(ZKHttpRequest *)request {
+	[self performSelector:@selector(enqueueOnNetworkThread:) onThread:[ZKHttpTransport networkThread] withObject:request waitUntilDone:NO];
+}
+
+- (void)cancelRequest:(ZKHttpRequest *)request {
+	[self performSelector:@selector(cancelOnNetworkThread:) onThread:[ZKHttpTransport networkThread] withObject:request waitUntilDone:NO];
+}
+
+- (void)cancelOnNetworkThread:(ZKHttpRequest *)request {
+	NSString *host = [[[[request request] URL] host] lowercaseString];
+	if (host == nil) host = @"";
+	NSMutableArray *q = [pending objectForKey:host];
+	// it may be in the queue, or already running, either way cancelConnection wraps it up.
+	[[request retain] autorelease];
+	[q removeObjectIdenticalTo:request];
+	if ([q count] == 0)
+		[pending removeObjectForKey:host];
+	[request cancelConnection];
+}
+
+- (NSUInteger)queuedRequestCount {
+	// the queues are only touched on the network thread, so ask it.
+	NSMutableArray *counts = [NSMutableArray arrayWithCapacity:1];
+	[self performSelector:@selector(countPending:) onThread:[ZKHttpTransport networkThread] withObject:counts waitUntilDone:YES];
+	return [[counts lastObject] unsignedIntegerValue];
+}
+
+- (void)countPending:(NSMutableArray *)result {
+	NSUInteger count = 0;
+	for (NSArray *q in [pending allValues])
+		count += [q count];
+	[result addObject:[NSNumber numberWithUnsignedInteger:count]];
+}
+
+- (void)enqueueOnNetworkThread:(ZKHttpRequest *)request {
+	NSString *host = [[[[request request] URL] host] lowercaseString];
+	if (host == nil) host = @"";
+	NSMutableArray *q = [pending objectForKey:host];
+	if (q == nil) {
+		q = [NSMutableArray array];
+		[pending setObject:q forKey:host];
+	}
+	[q addObject:request];
+	[self startPendingRequests:host];
+}
+
+- (void)startPendingRequests:(NSString *)host {
+	NSMutableArray *q = [pending objectForKey:host];
+	NSUInteger active = [[activeCounts objectForKey:host] unsignedIntegerValue];
+	NSUInteger max = [self maxConcurrentRequestsPerHost];
+	while (active < max && [q count] > 0) {
+		ZKHttpRequest *r = [[q objectAtIndex:0] retain];
+		[q removeObjectAtIndex:0];
+		active++;
+		[activeCounts setObject:[NSNumber numberWithUnsignedInteger:active] forKey:host];
+		[r startConnectionWithCompletion:^(void) {
+			NSUInteger n = [[activeCounts objectForKey:host] unsignedIntegerValue] - 1;
+			if (n == 0)
+				[activeCounts removeObjectForKey:host];
+			else
+				[activeCounts setObject:[NSNumber numberWithUnsignedInteger:n] forKey:host];
+			[self startPendingRequests:host];
+		}];
+		[r release];
+	}
+	if ([q count] == 0)
+		[pending removeObjectForKey:host];
+}
+
+- (void)startAllPendingRequests {
+	for (NSString *host in [pending allKeys])
+		[self startPendingRequests:host];
+}
+
+@end
@@ -0,0 +1,63 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// A persistent cache of describe results, it keeps the raw XML of each
+// response, gzip'd, in a single file per org & user, so that the next launch
+// can decode describes from disk instead of waiting on the network.
+//
+// The file is tagged with the API version the responses came from, if that
+// doesn't match the version asked for, the file is ignored (and replaced on
+// the next save). It's safe to use from any thread.
+@interface ZKMetadataCache : NSObject {
+	NSString			*path;
+	int					apiVersion;
+	NSMutableDictionary	*entries;	// key -> gzip'd xml.
+	NSMutableDictionary	*dates;		// key -> NSNumber of the CFAbsoluteTime it was stored.
+	BOOL				loaded, saveScheduled;
+	dispatch_queue_t	queue;
+}
+
+// returns a path in the user's Caches directory for this org & user.
++ (NSString *)defaultPathForOrgId:(NSString *)orgId userId:(NSString *)userId;
+
+// the file isn't read until the first time the cache is used.
+- (id)initWithPath:(NSString *)path apiVersion:(int)apiVersion;
+
+@property (readonly) NSString *path;
+@property (readonly) int apiVersion;
+
+// returns the XML stored for this key, or nil.
+- (NSData *)xmlForKey:(NSString *)key;
+
+// returns when the XML for this key was stored, or nil.
+- (NSDate *)dateForKey:(NSString *)key;
+
+// stores the XML for this key, saves are batched up and written shortly
+// afterwards, on a background queue.
+- (void)setXml:(NSData *)xml forKey:(NSString *)key;
+
+// clears the cache and deletes the file.
+- (void)removeAllEntries;
+
+// writes any pending changes to disk now.
+- (void)save;
+
+@end
@@ -0,0 +1,233 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "ZKMetadataCache.h"
+#import "ZKGzip.h"
+
+// The file is
+//		"ZKMC", uint16 format version, uint16 api version, uint32 entry count
+// followed by each entry as
+//		uint16 key length, key (UTF8), float64 time stored, uint32 length, gzip'd xml
+// all little endian.
+static const char CACHE_MAGIC[4] = { 'Z', 'K', 'M', 'C' };
+static const uint16_t CACHE_FORMAT_VERSION = 2;
+
+// how long to wait after a change before writing the file, so that a burst of describes at login is written once.
+static const int64_t SAVE_DELAY_NSEC = 2 * NSEC_PER_SEC;
+
+typedef struct {
+	const uint8_t	*p;
+	const uint8_t	*end;
+} cacheReader;
+
+static BOOL readBytes(cacheReader *r, void *dest, size_t len) {
+	if ((size_t)(r->end - r->p) < len) return NO;
+	memcpy(dest, r->p, len);
+	r->p += len;
+	return YES;
+}
+
+static BOOL readUInt16(cacheReader *r, uint16_t *v) {
+	if (!readBytes(r, v, sizeof(*v))) return NO;
+	*v = CFSwapInt16LittleToHost(*v);
+	return YES;
+}
+
+static BOOL readUInt32(cacheReader *r, uint32_t *v) {
+	if (!readBytes(r, v, sizeof(*v))) return NO;
+	*v = CFSwapInt32LittleToHost(*v);
+	return YES;
+}
+
+static BOOL readFloat64(cacheReader *r, double *v) {
+	uint64_t bits;
+	if (!readBytes(r, &bits, sizeof(bits))) return NO;
+	bits = CFSwapInt64LittleToHost(bits);
+	memcpy(v, &bits, sizeof(*v));
+	return YES;
+}
+
+static void appendUInt16(NSMutableData *d, uint16_t v) {
+	v = CFSwapInt16HostToLittle(v);
+	[d appendBytes:&v length:sizeof(v)];
+}
+
+static void appendUInt32(NSMutableData *d, uint32_t v) {
+	v = CFSwapInt32HostToLittle(v);
+	[d appendBytes:&v length:sizeof(v)];
+}
+
+static void appendFloat64(NSMutableData *d, double v) {
+	uint64_t bits;
+	memcpy(&bits, &v, sizeof(bits));
+	bits = CFSwapInt64HostToLittle(bits);
+	[d appendBytes:&bits length:sizeof(bits)];
+}
+
+@interface ZKMetadataCache ()
+- (void)load;
+- (BOOL)readEntries:(NSData *)file;
+- (void)writeFile;
+@end
+
+@implementation ZKMetadataCache
+
+@synthesize path, apiVersion;
+
++ (NSString *)defaultPathForOrgId:(NSString *)orgId userId:(NSString *)userId {
+	NSString *caches = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) objectAtIndex:0];
+	return [caches stringByAppendingPathComponent:[NSString stringWithFormat:@"%@-%@.zkmeta", orgId, userId]];
+}
+
+- (id)initWithPath:(NSString *)p apiVersion:(int)v {
+	self = [super init];
+	path = [p copy];
+	apiVersion = v;
+	entries = [[NSMutableDictionary alloc] init];
+	dates = [[NSMutableDictionary alloc] init];
+	queue = dispatch_queue_create("com.pocketsoap.zksforce.metadatacache", NULL);
+	return self;
+}
+
+- (void)dealloc {
+	[path release];
+	[entries release];
+	[dates release];
+	dispatch_release(queue);
+	[super dealloc];
+}
+
+- (NSData *)xmlForKey:(NSString *)key {
+	__block NSData *gz = nil;
+	dispatch_sync(queue, ^(void) {
+		[self load];
+		gz = [[entries objectForKey:key] retain];
+	});
+	// inflate outside the queue, so readers of different keys don't wait on each other.
+	NSData *xml = gz == nil ? nil : [ZKGzip gunzipData:gz];
+	[gz release];
+	return xml;
+}
+
+- (NSDate *)dateForKey:(NSString *)key {
+	__block NSDate *date = nil;
+	dispatch_sync(queue, ^(void) {
+		[self load];
+		NSNumber *t = [dates objectForKey:key];
+		if (t != nil)
+			date = [[NSDate alloc] initWithTimeIntervalSinceReferenceDate:[t doubleValue]];
+	});
+	return [date autorelease];
+}
+
+- (void)setXml:(NSData *)xml forKey:(NSString *)key {
+	if (xml == nil || key == nil) return;
+	NSString *k = [[key copy] autorelease];
+	NSNumber *now = [NSNumber numberWithDouble:CFAbsoluteTimeGetCurrent()];
+	dispatch_async(queue, ^(void) {
+		[self load];
+		[entries setObject:[ZKGzip gzipData:xml] forKey:k];
+		[dates setObject:now forKey:k];
+		if (saveScheduled) return;
+		saveScheduled = YES;
+		dispatch_after(dispatch_time(DISPATCH_TIME_NOW, SAVE_DELAY_NSEC), queue, ^(void) {
+			if (saveScheduled)
+				[self writeFile];
+		});
+	});
+}
+
+- (void)removeAllEntries {
+	dispatch_sync(queue, ^(void) {
+		loaded = YES;
+		saveScheduled = NO;
+		[entries removeAllObjects];
+		[dates removeAllObjects];
+		[[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+	});
+}
+
+- (void)save {
+	dispatch_sync(queue, ^(void) {
+		if (saveScheduled)
+			[self writeFile];
+	});
+}
+
+// these are all called on queue.
+- (void)load {
+	if (loaded) return;
+	loaded = YES;
+	NSData *file = [NSData dataWithContentsOfFile:path options:NSDataReadingMapped error:NULL];
+	if (file != nil && ![self readEntries:file]) {
+		[entries removeAllObjects];
+		[dates removeAllObjects];
+	}
+}
+
+// returns NO if the file is from a different API version, or isn't a cache file at all.
+- (BOOL)readEntries:(NSData *)file {
+	cacheReader r = { [file bytes], (const uint8_t *)[file bytes] + [file length] };
+	char magic[4];
+	uint16_t format, version, keyLen;
+	uint32_t count, len;
+	double stored;
+	if (!readBytes(&r, magic, sizeof(magic)) || memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0) return NO;
+	if (!readUInt16(&r, &format) || format != CACHE_FORMAT_VERSION) return NO;
+	if (!readUInt16(&r, &version) || version != apiVersion) return NO;
+	if (!readUInt32(&r, &count)) return NO;
+	for (uint32_t i = 0; i < count; i++) {
+		if (!readUInt16(&r, &keyLen) || (size_t)(r.end - r.p) < keyLen) return NO;
+		NSString *key = [[NSString alloc] initWithBytes:r.p length:keyLen encoding:NSUTF8StringEncoding];
+		r.p += keyLen;
+		if (key == nil || !readFloat64(&r, &stored) || !readUInt32(&r, &len) || (size_t)(r.end - r.p) < len) {
+			[key release];
+			return NO;
+		}
+		// copy the xml out, so the mapping can go away once we're done.
+		[entries setObject:[NSData dataWithBytes:r.p length:len] forKey:key];
+		[dates setObject:[NSNumber numberWithDouble:stored] forKey:key];
+		r.p += len;
+		[key release];
+	}
+	return YES;
+}
+
+- (void)writeFile {
+	saveScheduled = NO;
+	NSMutableData *file = [NSMutableData dataWithCapacity:64 * 1024];
+	[file appendBytes:CACHE_MAGIC length:sizeof(CACHE_MAGIC)];
+	appendUInt16(file, CACHE_FORMAT_VERSION);
+	appendUInt16(file, (uint16_t)apiVersion);
+	appendUInt32(file, (uint32_t)[entries count]);
+	for (NSString *key in entries) {
+		NSData *k = [key dataUsingEncoding:NSUTF8StringEncoding];
+		NSData *gz = [entries objectForKey:key];
+		appendUInt16(file, (uint16_t)[k length]);
+		[file appendData:k];
+		appendFloat64(file, [[dates objectForKey:key] doubleValue]);
+		appendUInt32(file, (uint32_t)[gz length]);
+		[file appendData:gz];
+	}
+	[file writeToFile:path atomically:YES];
+}
+
+@end
@@ -0,0 +1,88 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// The phases of a single API call that are timed.
+typedef enum {
+	ZKOperationPhaseEnvelope,	// building the request envelope.
+	ZKOperationPhaseQueued,		// waiting in the transport for a free connection to the host.
+	ZKOperationPhaseFirstByte,	// from starting the request to the first byte of the response.
+	ZKOperationPhaseLastByte,	// from the first byte of the response to the last.
+	ZKOperationPhaseParse,		// parsing the response XML.
+	ZKOperationPhaseDecode,		// turning the XML into objects.
+	ZKOperationPhaseTotal,		// the whole call, from building the envelope to having the decoded result.
+	ZKOperationPhaseCount
+} ZKOperationPhase;
+
+// Counters for a single type of API call (e.g. query)
+@interface ZKOperationStat : NSObject <NSCopying> {
+	NSString			*name;
+	unsigned long long	calls;
+	unsigned long long	requestBytes, requestBytesUncompressed;
+	unsigned long long	responseBytes, responseBytesUncompressed;
+	double				*samples[ZKOperationPhaseCount];
+	NSUInteger			sampleCounts[ZKOperationPhaseCount];
+}
+@property (readonly) NSString *name;
+@property (readonly) unsigned long long calls;
+// the request/response bytes are what went over the wire, the uncompressed
+// ones are the size of the XML, they're the same if compression is off.
+@property (readonly) unsigned long long requestBytes;
+@property (readonly) unsigned long long requestBytesUncompressed;
+@property (readonly) unsigned long long responseBytes;
+@property (readonly) unsigned long long responseBytesUncompressed;
+
+// how many times the phase has been timed.
+- (NSUInteger)sampleCountForPhase:(ZKOperationPhase)phase;
+
+// the duration in seconds that p percent (0-100) of the recent calls were
+// at or under for this phase, or 0 if it's not been timed. The percentiles
+// are over a rolling window of the most recent calls.
+- (NSTimeInterval)percentile:(double)p forPhase:(ZKOperationPhase)phase;
+
++ (NSString *)nameOfPhase:(ZKOperationPhase)phase;
+@end
+
+// Tracks per operation counts of the bytes sent & received by a client,
+// and how long each phase of those calls took.
+// This is safe to use from any thread.
+@interface ZKOperationStats : NSObject {
+	NSMutableDictionary *operations;
+}
+
+// the operation name for a request, i.e. the first element in the soap:Body.
++ (NSString *)operationNameForEnvelope:(NSString *)payload;
++ (NSString *)operationNameForEnvelopeData:(NSData *)payload;
+
+- (void)recordOperation:(NSString *)operation
+		   requestBytes:(NSUInteger)reqBytes uncompressed:(NSUInteger)reqUncompressed
+		  responseBytes:(NSUInteger)respBytes uncompressed:(NSUInteger)respUncompressed;
+
+- (void)recordPhase:(ZKOperationPhase)phase ofOperation:(NSString *)operation duration:(NSTimeInterval)duration;
+
+// returns a snapshot of the counters for this operation, or nil if there haven't been any calls to it.
+- (ZKOperationStat *)statForOperation:(NSString *)operation;
+- (NSArray *)operationNames;
+- (void)reset;
+
+// All the counters, and the p50/p95/p99 of each phase in milliseconds, as a JSON object keyed by operation name.
+- (NSString *)JSONRepresentation;
+
+@end
@@ -0,0 +1,237 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "ZKOperationStats.h"
+
+// percentiles are calculated over this many of the most recent calls.
+static const NSUInteger ROLLING_WINDOW = 256;
+
+static NSString *PHASE_NAMES[ZKOperationPhaseCount] = { @"envelope", @"queued", @"firstByte", @"lastByte", @"parse", @"decode", @"total" };
+
+static int compareDoubles(const void *a, const void *b) {
+	double l = *(const double *)a, r = *(const double *)b;
+	return l < r ? -1 : (l > r ? 1 : 0);
+}
+
+@interface ZKOperationStat ()
+- (id)initWithName:(NSString *)n;
+- (void)addRequestBytes:(NSUInteger)reqBytes uncompressed:(NSUInteger)reqUncompressed
+		  responseBytes:(NSUInteger)respBytes uncompressed:(NSUInteger)respUncompressed;
+- (void)addSample:(NSTimeInterval)duration forPhase:(ZKOperationPhase)phase;
+- (NSString *)JSONRepresentation;
+@end
+
+@implementation ZKOperationStat
+
+@synthesize name, calls, requestBytes, requestBytesUncompressed, responseBytes, responseBytesUncompressed;
+
++ (NSString *)nameOfPhase:(ZKOperationPhase)phase {
+	return phase < ZKOperationPhaseCount ? PHASE_NAMES[phase] : nil;
+}
+
+- (id)initWithName:(NSString *)n {
+	self = [super init];
+	name = [n copy];
+	return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+	ZKOperationStat *rhs = [[ZKOperationStat alloc] initWithName:name];
+	rhs->calls = calls;
+	rhs->requestBytes = requestBytes;
+	rhs->requestBytesUncompressed = requestBytesUncompressed;
+	rhs->responseBytes = responseBytes;
+	rhs->responseBytesUncompressed = responseBytesUncompressed;
+	for (int i = 0; i < ZKOperationPhaseCount; i++) {
+		rhs->sampleCounts[i] = sampleCounts[i];
+		if (samples[i] == NULL) continue;
+		rhs->samples[i] = malloc(ROLLING_WINDOW * sizeof(double));
+		memcpy(rhs->samples[i], samples[i], ROLLING_WINDOW * sizeof(double));
+	}
+	return rhs;
+}
+
+- (void)dealloc {
+	for (int i = 0; i < ZKOperationPhaseCount; i++)
+		free(samples[i]);
+	[name release];
+	[super dealloc];
+}
+
+- (void)addRequestBytes:(NSUInteger)reqBytes uncompressed:(NSUInteger)reqUncompressed
+		  responseBytes:(NSUInteger)respBytes uncompressed:(NSUInteger)respUncompressed {
+	calls++;
+	requestBytes += reqBytes;
+	requestBytesUncompressed += reqUncompressed;
+	responseBytes += respBytes;
+	responseBytesUncompressed += respUncompressed;
+}
+
+- (void)addSample:(NSTimeInterval)duration forPhase:(ZKOperationPhase)phase {
+	if (phase >= ZKOperationPhaseCount) return;
+	if (samples[phase] == NULL)
+		samples[phase] = calloc(ROLLING_WINDOW, sizeof(double));
+	samples[phase][sampleCounts[phase] % ROLLING_WINDOW] = duration;
+	sampleCounts[phase]++;
+}
+
+- (NSUInteger)sampleCountForPhase:(ZKOperationPhase)phase {
+	return phase < ZKOperationPhaseCount ? sampleCounts[phase] : 0;
+}
+
+- (NSTimeInterval)percentile:(double)p forPhase:(ZKOperationPhase)phase {
+	if (phase >= ZKOperationPhaseCount || sampleCounts[phase] == 0) return 0;
+	NSUInteger n = MIN(sampleCounts[phase], ROLLING_WINDOW);
+	double sorted[ROLLING_WINDOW];
+	memcpy(sorted, samples[phase], n * sizeof(double));
+	qsort(sorted, n, sizeof(double), compareDoubles);
+	// nearest rank
+	NSUInteger rank = (NSUInteger)ceil(p / 100.0 * n);
+	return sorted[rank == 0 ? 0 : MIN(rank, n) - 1];
+}
+
+- (NSString *)JSONRepresentation {
+	NSMutableString *json = [NSMutableString stringWithFormat:@"{\"calls\":%llu,\"requestBytes\":%llu,\"requestBytesUncompressed\":%llu,\"responseBytes\":%llu,\"responseBytesUncompressed\":%llu,\"phases\":{",
+							 calls, requestBytes, requestBytesUncompressed, responseBytes, responseBytesUncompressed];
+	BOOL first = YES;
+	for (int i = 0; i < ZKOperationPhaseCount; i++) {
+		if (sampleCounts[i] == 0) continue;
+		[json appendFormat:@"%@\"%@\":{\"samples\":%lu,\"p50\":%.3f,\"p95\":%.3f,\"p99\":%.3f}", first ? @"" : @",", PHASE_NAMES[i], (unsigned long)sampleCounts[i],
+			[self percentile:50 forPhase:i] * 1000, [self percentile:95 forPhase:i] * 1000, [self percentile:99 forPhase:i] * 1000];
+		first = NO;
+	}
+	[json appendString:@"}}"];
+	return json;
+}
+
+- (NSString *)description {
+	return [NSString stringWithFormat:@"%@ calls=%llu request=%llu/%llu response=%llu/%llu total p50=%.0fms p95=%.0fms p99=%.0fms", name, calls,
+			requestBytes, requestBytesUncompressed, responseBytes, responseBytesUncompressed,
+			[self percentile:50 forPhase:ZKOperationPhaseTotal] * 1000, [self percentile:95 forPhase:ZKOperationPhaseTotal] * 1000, [self percentile:99 forPhase:ZKOperationPhaseTotal] * 1000];
+}
+
+@end
+
+@implementation ZKOperationStats
+
++ (NSString *)operationNameForEnvelope:(NSString *)payload {
+	NSRange body = [payload rangeOfString:@"<s:Body><"];
+	if (body.location == NSNotFound) return nil;
+	NSUInteger start = NSMaxRange(body);
+	NSRange end = [payload rangeOfCharacterFromSet:[NSCharacterSet characterSetWithCharactersInString:@" >/"] options:NSLiteralSearch range:NSMakeRange(start, [payload length] - start)];
+	if (end.location == NSNotFound) return nil;
+	return [payload substringWithRange:NSMakeRange(start, end.location - start)];
+}
+
++ (NSString *)operationNameForEnvelopeData:(NSData *)payload {
+	static const char bodyTag[] = "<s:Body><";
+	const char *bytes = [payload bytes], *end = bytes + [payload length];
+	const char *body = NULL;
+	for (const char *p = bytes; p + sizeof(bodyTag) - 1 <= end; p++) {
+		if (*p == '<' && memcmp(p, bodyTag, sizeof(bodyTag) - 1) == 0) {
+			body = p + sizeof(bodyTag) - 1;
+			break;
+		}
+	}
+	if (body == NULL) return nil;
+	const char *p = body;
+	while (p < end && *p != ' ' && *p != '>' && *p != '/')
+		p++;
+	if (p == end) return nil;
+	return [[[NSString alloc] initWithBytes:body length:p - body encoding:NSUTF8StringEncoding] autorelease];
+}
+
+- (id)init {
+	self = [super init];
+	operations = [[NSMutableDictionary alloc] init];
+	return self;
+}
+
+- (void)dealloc {
+	[operations release];
+	[super dealloc];
+}
+
+// call with the lock held.
+- (ZKOperationStat *)statForOperationLocked:(NSString *)operation {
+	ZKOperationStat *s = [operations objectForKey:operation];
+	if (s == nil) {
+		s = [[[ZKOperationStat alloc] initWithName:operation] autorelease];
+		[operations setObject:s forKey:operation];
+	}
+	return s;
+}
+
+- (void)recordOperation:(NSString *)operation
+		   requestBytes:(NSUInteger)reqBytes uncompressed:(NSUInteger)reqUncompressed
+		  responseBytes:(NSUInteger)respBytes uncompressed:(NSUInteger)respUncompressed {
+	if (operation == nil) return;
+	@synchronized(self) {
+		[[self statForOperationLocked:operation] addRequestBytes:reqBytes uncompressed:reqUncompressed responseBytes:respBytes uncompressed:respUncompressed];
+	}
+}
+
+- (void)recordPhase:(ZKOperationPhase)phase ofOperation:(NSString *)operation duration:(NSTimeInterval)duration {
+	if (operation == nil) return;
+	@synchronized(self) {
+		[[self statForOperationLocked:operation] addSample:duration forPhase:phase];
+	}
+}
+
+- (ZKOperationStat *)statForOperation:(NSString *)operation {
+	@synchronized(self) {
+		return [[[operations objectForKey:operation] copy] autorelease];
+	}
+}
+
+- (NSArray *)operationNames {
+	@synchronized(self) {
+		return [operations allKeys];
+	}
+}
+
+- (void)reset {
+	@synchronized(self) {
+		[operations removeAllObjects];
+	}
+}
+
+- (NSString *)JSONRepresentation {
+	NSMutableString *json = [NSMutableString stringWithString:@"{"];
+	@synchronized(self) {
+		BOOL first = YES;
+		for (NSString *op in [[operations allKeys] sortedArrayUsingSelector:@selector(compare:)]) {
+			// operation names are xml element names, so there's nothing in them that needs escaping.
+			[json appendFormat:@"%@\"%@\":%@", first ? @"" : @",", op, [[operations objectForKey:op] JSONRepresentation]];
+			first = NO;
+		}
+	}
+	[json appendString:@"}"];
+	return json;
+}
+
+- (NSString *)description {
+	@synchronized(self) {
+		return [[operations allValues] description];
+	}
+}
+
+@end
@@ -26,5 +26,7 @@
 
 - (id)initWithSessionHeader:(NSString *)sessionId clientId:(NSString *)clientId;
 - (id)initWithSessionAndMruHeaders:(NSString *)sessionId mru:(BOOL)mru clientId:(NSString *)clientId;
+- (id)initWithSessionHeader:(NSString *)sessionId clientId:(NSString *)clientId queryBatchSize:(int)batchSize;
+- (id)initWithSessionAndMruHeaders:(NSString *)sessionId mru:(BOOL)mru clientId:(NSString *)clientId queryBatchSize:(int)batchSize;
 
 @end
@@ -28,11 +28,20 @@
 }
 
 - (id)initWithSessionAndMruHeaders:(NSString *)sessionId mru:(BOOL)mru clientId:(NSString *)clientId {
+	return [self initWithSessionAndMruHeaders:sessionId mru:mru clientId:clientId queryBatchSize:0];
+}
+
+- (id)initWithSessionHeader:(NSString *)sessionId clientId:(NSString *)clientId queryBatchSize:(int)batchSize {
+	return [self initWithSessionAndMruHeaders:sessionId mru:NO clientId:clientId queryBatchSize:batchSize];
+}
+
+- (id)initWithSessionAndMruHeaders:(NSString *)sessionId mru:(BOOL)mru clientId:(NSString *)clientId queryBatchSize:(int)batchSize {
 	self = [super init];
 	[self start:@"urn:partner.soap.sforce.com"];
 	[self writeSessionHeader:sessionId];
 	[self writeCallOptionsHeader:clientId];
 	[self writeMruHeader:mru];
+	[self writeQueryOptionsHeader:batchSize];
 	[self moveToBody];
 	return self;
 }
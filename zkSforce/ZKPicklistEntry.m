@@ -21,7 +21,21 @@
 
 #import "ZKPicklistEntry.h"
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "active",       zkXmlBoolean },
+	{ "defaultValue", zkXmlBoolean },
+	{ "label",        zkXmlString },
+	{ "validFor",     zkXmlString },
+	{ "value",        zkXmlString },
+	{ NULL, 0 }
+};
+
 @implementation ZKPicklistEntry
+
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
 - (BOOL)active {
 	return [self boolean:@"active"];
 }
@@ -23,8 +23,22 @@
 #import "ZKPicklistEntry.h"
 #import "ZKParser.h"
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "picklistName", zkXmlString },
+	{ NULL, 0 }
+};
+
 @implementation ZKPicklistForRecordType
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
+-(void)dealloc {
+	[picklistValues release];
+	[super dealloc];
+}
+
 -(NSString *) picklistName {
 	return [self string:@"picklistName"];
 }
@@ -35,4 +49,9 @@
 	return picklistValues;
 }
 
+- (void)detach {
+	[[self picklistValues] makeObjectsPerformSelector:@selector(detach)];
+	[super detach];
+}
+
 @end
\ No newline at end of file
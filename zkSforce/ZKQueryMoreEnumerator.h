@@ -0,0 +1,67 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "zkBaseClient.h"
+
+@class ZKSforceClient;
+@class ZKQueryResult;
+@class ZKCancellationToken;
+
+typedef void (^zkQueryBatchBlock)(ZKQueryResult *batch, BOOL *stop);
+
+// Walks a queryMore chain, fetching batches ahead of the caller so that the
+// network isn't sitting idle while each batch is being processed. Each
+// queryMore call still has to wait for the previous one, as that's where its
+// locator comes from, but it's sent as soon as the previous batch has been
+// read, rather than after the caller has dealt with it. At most lookahead
+// batches are fetched and waiting to be handed to the caller at once, after
+// that fetching pauses until the caller catches up.
+@interface ZKQueryMoreEnumerator : NSObject {
+	ZKSforceClient		*client;
+	NSString			*queryLocator;
+	NSUInteger			lookahead;
+	NSUInteger			waiting;		// batches read, but not yet handed to the batch block.
+	BOOL				fetching;
+	BOOL				finished;
+	BOOL				recordBatches;
+	dispatch_queue_t	queue;
+	ZKCancellationToken	*token;
+	zkQueryBatchBlock			batchBlock;
+	zkFailWithExceptionBlock	failBlock;
+	void						(^completeBlock)(void);
+}
+
+// queryLocator is the locator from the query result you already have.
+- (id)initWithClient:(ZKSforceClient *)c queryLocator:(NSString *)locator lookahead:(NSUInteger)depth;
+
+// Starts fetching, each batch is passed to the batch block on the main thread,
+// in order. Setting stop cancels the rest of the chain. Once the last batch
+// has been handled completeBlock is called, or failBlock if a call fails, in
+// which case any batches read before the failure are still handed over first.
+// Cancelling the returned token stops everything, and no more blocks are called.
+- (ZKCancellationToken *)enumerateBatchesUsingBlock:(zkQueryBatchBlock)block failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(void (^)(void))completeBlock;
+
+// fetch each batch as a ZKRecordBatch rather than a ZKQueryResult of ZKSObjects, set this before starting.
+@property (assign) BOOL recordBatches;
+
+- (void)cancel;
+
+@end
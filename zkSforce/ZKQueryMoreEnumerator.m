@@ -0,0 +1,155 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "ZKQueryMoreEnumerator.h"
+#import "zkSforceClient.h"
+#import "zkQueryResult.h"
+#import "ZKCancellationToken.h"
+
+@interface ZKQueryMoreEnumerator ()
+- (void)fetchNext;
+- (void)finishedBatch;
+- (void)finishIfDone;
+- (void)releaseBlocks;
+@end
+
+@implementation ZKQueryMoreEnumerator
+
+@synthesize recordBatches;
+
+- (id)initWithClient:(ZKSforceClient *)c queryLocator:(NSString *)locator lookahead:(NSUInteger)depth {
+	self = [super init];
+	client = [c retain];
+	queryLocator = [locator copy];
+	lookahead = MAX(depth, 1);
+	queue = dispatch_queue_create("com.pocketsoap.zkSforce.queryMore", NULL);
+	token = [[ZKCancellationToken alloc] init];
+	return self;
+}
+
+- (void)dealloc {
+	[client release];
+	[queryLocator release];
+	dispatch_release(queue);
+	[token removeAllCancelHandlers];
+	[token release];
+	[self releaseBlocks];
+	[super dealloc];
+}
+
+- (void)releaseBlocks {
+	[batchBlock release];
+	[failBlock release];
+	[completeBlock release];
+	batchBlock = nil;
+	failBlock = nil;
+	completeBlock = nil;
+}
+
+- (ZKCancellationToken *)enumerateBatchesUsingBlock:(zkQueryBatchBlock)block failBlock:(zkFailWithExceptionBlock)fb completeBlock:(void (^)(void))cb {
+	batchBlock = [block copy];
+	failBlock = [fb copy];
+	completeBlock = [cb copy];
+	// the token is one of our ivars, so the handler mustn't retain us, or neither would ever go away.
+	// the handlers are dropped once the chain finishes, so it only runs while we're still around.
+	__block ZKQueryMoreEnumerator *blockSelf = self;
+	[token addCancelHandler:^(void) {
+		// the blocks may well be holding onto whoever is holding onto us.
+		[blockSelf retain];
+		dispatch_async(dispatch_get_main_queue(), ^(void) {
+			[blockSelf releaseBlocks];
+			[blockSelf release];
+		});
+	}];
+	dispatch_async(queue, ^(void) {
+		[self fetchNext];
+		[self finishIfDone];
+	});
+	return token;
+}
+
+- (void)cancel {
+	[token cancel];
+}
+
+// always called on our queue, which is where all the state is looked after.
+- (void)fetchNext {
+	if (fetching || queryLocator == nil || waiting >= lookahead || [token isCancelled]) return;
+	fetching = YES;
+	zkFailWithExceptionBlock fail = ^(NSException *ex) {
+		fetching = NO;
+		finished = YES;
+		[queryLocator release];
+		queryLocator = nil;
+		dispatch_async(dispatch_get_main_queue(), ^(void) {
+			if ([token isCancelled]) return;
+			failBlock(ex);
+			[self releaseBlocks];
+			// nothing's left in flight, and the handlers hold onto every request made along the way.
+			[token removeAllCancelHandlers];
+		});
+	};
+	zkCompleteQueryResultBlock done = ^(ZKQueryResult *qr) {
+		fetching = NO;
+		waiting++;
+		[queryLocator release];
+		queryLocator = [[qr queryLocator] copy];
+		dispatch_async(dispatch_get_main_queue(), ^(void) {
+			if ([token isCancelled]) return;
+			BOOL stop = NO;
+			if (qr != nil)
+				batchBlock(qr, &stop);
+			if (stop) {
+				[token cancel];
+				return;
+			}
+			dispatch_async(queue, ^(void) {
+				[self finishedBatch];
+			});
+		});
+		// start on the next batch while the caller deals with this one.
+		[self fetchNext];
+	};
+	if (recordBatches)
+		[client performRecordBatchQueryMore:queryLocator token:token queue:queue failBlock:fail completeBlock:(zkCompleteRecordBatchBlock)done];
+	else
+		[client performQueryMore:queryLocator token:token queue:queue failBlock:fail completeBlock:done];
+}
+
+// called on our queue once the caller has dealt with a batch.
+- (void)finishedBatch {
+	waiting--;
+	[self fetchNext];
+	[self finishIfDone];
+}
+
+- (void)finishIfDone {
+	if (finished || fetching || waiting > 0 || queryLocator != nil) return;
+	finished = YES;
+	dispatch_async(dispatch_get_main_queue(), ^(void) {
+		if ([token isCancelled]) return;
+		completeBlock();
+		[self releaseBlocks];
+		[token removeAllCancelHandlers];
+	});
+}
+
+@end
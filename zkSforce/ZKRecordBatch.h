@@ -0,0 +1,79 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "zkQueryResult.h"
+
+@class ZKRecordBatch;
+
+// One row of a ZKRecordBatch. It's a dictionary of field name to value, the
+// same as a ZKSObject's fields, and answers the ZKSObject calls for reading
+// the row. It's just a pointer to the batch and a row number. The batch owns
+// its rows, retaining or releasing a row retains or releases the whole batch,
+// so a row you hold onto keeps the batch around, and vice versa.
+@interface ZKRecordBatchRow : NSDictionary {
+	ZKRecordBatch	*batch;
+	NSUInteger		row;
+	NSArray			*names;		// the fields this row has a value for, worked out the first time they're asked for.
+}
+
+- (id)initWithBatch:(ZKRecordBatch *)b row:(NSUInteger)r;
+
+- (NSString *)id;
+- (NSString *)type;
+- (id)fieldValue:(NSString *)field;
+- (NSArray *)orderedFieldNames;
+
+@end
+
+// A query result that stores its records by column rather than as a
+// ZKSObject each. The field names are stored once for the batch, and each
+// field's values for every row are kept together, so a row costs a slot in
+// each column instead of its own dictionary, order array and set, and its
+// own copy of every field name. records returns row views onto the batch.
+@interface ZKRecordBatch : ZKQueryResult {
+	NSMutableArray			*fieldNames;		// in the order they were first seen.
+	NSMutableDictionary		*columnIndexes;		// field name -> NSNumber
+	CFMutableDictionaryRef	columnsByXmlName;	// the document's interned name -> column index + 1
+	id						**columns;			// columns[column][row], nil where a row doesn't have that field.
+	NSString				**ids;
+	NSString				**types;
+	NSUInteger				rowCount, rowCapacity;
+	ZKRecordBatchRow		**rows;				// made the first time they're asked for, then kept.
+}
+
+// decodes the records elements, along with size/done/queryLocator, from a QueryResult element.
+- (id)initFromXmlNode:(zkElement *)node;
+
+// for building up a batch from records streamed from the push parser, add
+// each one as it arrives, then read size/done/queryLocator from what's left.
+- (void)addRecordFromXmlNode:(zkElement *)node;
+- (void)finishFromXmlNode:(zkElement *)node;
+
+- (NSUInteger)count;
+- (NSArray *)fieldNames;
+- (ZKRecordBatchRow *)rowAtIndex:(NSUInteger)row;
+
+// NSNull if the field was null in that row, nil if the row doesn't have it at all.
+- (id)valueOfField:(NSString *)field atRow:(NSUInteger)row;
+- (NSString *)idAtRow:(NSUInteger)row;
+- (NSString *)typeAtRow:(NSUInteger)row;
+
+@end
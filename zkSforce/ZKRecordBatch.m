@@ -0,0 +1,291 @@
+// Copyright (c) 2011 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "ZKRecordBatch.h"
+#import "zkSObject.h"
+#import "zkParser.h"
+
+@implementation ZKRecordBatchRow
+
+// only the batch makes rows, and it's the one that frees them, in its dealloc.
+- (id)initWithBatch:(ZKRecordBatch *)b row:(NSUInteger)r {
+	self = [super init];
+	batch = b;
+	row = r;
+	return self;
+}
+
+- (void)dealloc {
+	[names release];
+	[super dealloc];
+}
+
+// the row lives as long as the batch does, so it's the batch that's retained and released,
+// that way holding onto a row keeps the batch around, without the batch's rows keeping it alive for ever.
+- (id)retain {
+	[batch retain];
+	return self;
+}
+
+- (oneway void)release {
+	[batch release];
+}
+
+- (NSUInteger)retainCount {
+	return [batch retainCount];
+}
+
+// rows can't be changed, so there's no need to copy.
+- (id)copyWithZone:(NSZone *)zone {
+	return [self retain];
+}
+
+- (NSArray *)orderedFieldNames {
+	@synchronized (self) {
+		if (names == nil) {
+			NSMutableArray *n = [[NSMutableArray alloc] init];
+			for (NSString *f in [batch fieldNames]) {
+				if ([batch valueOfField:f atRow:row] != nil)
+					[n addObject:f];
+			}
+			names = n;
+		}
+		return names;
+	}
+}
+
+- (NSUInteger)count {
+	return [[self orderedFieldNames] count];
+}
+
+- (id)objectForKey:(id)key {
+	return [batch valueOfField:key atRow:row];
+}
+
+- (NSEnumerator *)keyEnumerator {
+	return [[self orderedFieldNames] objectEnumerator];
+}
+
+- (NSString *)id {
+	return [batch idAtRow:row];
+}
+
+- (NSString *)type {
+	return [batch typeAtRow:row];
+}
+
+- (id)fieldValue:(NSString *)field {
+	id v = [batch valueOfField:field atRow:row];
+	return v == [NSNull null] ? nil : v;
+}
+
+@end
+
+@interface ZKRecordBatch ()
+- (NSUInteger)columnForXmlName:(const char *)name;
+- (void)ensureRowCapacity:(NSUInteger)needed;
+- (id)complexValueOfField:(const char *)name inRecord:(zkElement *)node;
+- (ZKRecordBatchRow **)rows;
+@end
+
+static id *growSlots(id *slots, NSUInteger oldCount, NSUInteger newCount) {
+	slots = realloc(slots, newCount * sizeof(id));
+	memset(slots + oldCount, 0, (newCount - oldCount) * sizeof(id));
+	return slots;
+}
+
+static void releaseSlots(id *slots, NSUInteger count) {
+	for (NSUInteger i = 0; i < count; i++)
+		[slots[i] release];
+	free(slots);
+}
+
+@implementation ZKRecordBatch
+
+- (id)init {
+	self = [super init];
+	fieldNames = [[NSMutableArray alloc] init];
+	columnIndexes = [[NSMutableDictionary alloc] init];
+	columnsByXmlName = CFDictionaryCreateMutable(NULL, 0, NULL, NULL);
+	return self;
+}
+
+- (id)initFromXmlNode:(zkElement *)node {
+	self = [self init];
+	for (zkElement *r in [node childElements:@"records"])
+		[self addRecordFromXmlNode:r];
+	[self finishFromXmlNode:node];
+	return self;
+}
+
+- (void)dealloc {
+	for (NSUInteger c = 0; c < [fieldNames count]; c++)
+		releaseSlots(columns[c], rowCount);
+	free(columns);
+	releaseSlots(ids, rowCount);
+	releaseSlots(types, rowCount);
+	CFRelease(columnsByXmlName);
+	// the rows' release goes to us, so they're torn down directly.
+	if (rows != NULL) {
+		for (NSUInteger i = 0; i < rowCount; i++)
+			[rows[i] dealloc];
+		free(rows);
+	}
+	[fieldNames release];
+	[columnIndexes release];
+	[super dealloc];
+}
+
+// we don't change once we're finished, so there's no need to copy.
+- (id)copyWithZone:(NSZone *)zone {
+	return [self retain];
+}
+
+- (void)ensureRowCapacity:(NSUInteger)needed {
+	if (needed <= rowCapacity) return;
+	NSUInteger cap = MAX(rowCapacity * 2, 64);
+	for (NSUInteger c = 0; c < [fieldNames count]; c++)
+		columns[c] = growSlots(columns[c], rowCapacity, cap);
+	ids = growSlots(ids, rowCapacity, cap);
+	types = growSlots(types, rowCapacity, cap);
+	rowCapacity = cap;
+}
+
+// Element names are interned by the parser, so every row of a response
+// uses the same pointer for a field's name, and once we've seen it we don't
+// need to look at the string again.
+- (NSUInteger)columnForXmlName:(const char *)name {
+	NSUInteger col = (NSUInteger)CFDictionaryGetValue(columnsByXmlName, name);
+	if (col != 0) return col - 1;
+	NSString *n = [NSString stringWithUTF8String:name];
+	NSNumber *existing = [columnIndexes objectForKey:n];
+	if (existing != nil) {
+		col = [existing unsignedIntegerValue];
+	} else {
+		col = [fieldNames count];
+		[fieldNames addObject:n];
+		[columnIndexes setObject:[NSNumber numberWithUnsignedInteger:col] forKey:n];
+		columns = realloc(columns, (col + 1) * sizeof(id *));
+		columns[col] = calloc(MAX(rowCapacity, 1), sizeof(id));
+	}
+	CFDictionarySetValue(columnsByXmlName, name, (const void *)(col + 1));
+	return col;
+}
+
+// a field with no text is either null, empty, or a nested sObject or QueryResult.
+- (id)complexValueOfField:(const char *)name inRecord:(zkElement *)node {
+	zkElement *f = [node childElement:[NSString stringWithUTF8String:name]];
+	NSString *xsiNil = [f attributeValue:@"nil" ns:NS_URI_XSI];
+	if (xsiNil != nil && [xsiNil isEqualToString:@"true"])
+		return [NSNull null];
+	NSString *xsiType = [f attributeValue:@"type" ns:NS_URI_XSI];
+	if ([xsiType hasSuffix:@"QueryResult"])
+		return [[[ZKQueryResult alloc] initFromXmlNode:f] autorelease];
+	if ([xsiType hasSuffix:@"sObject"])
+		return [[[ZKSObject alloc] initFromXmlNode:f] autorelease];
+	// an empty string, which ZKSObject doesn't keep either.
+	return nil;
+}
+
+- (void)addRecordFromXmlNode:(zkElement *)node {
+	NSString *xsiNil = [node attributeValue:@"nil" ns:NS_URI_XSI];
+	if (xsiNil != nil && [xsiNil isEqualToString:@"true"])
+		return;
+	[self ensureRowCapacity:rowCount + 1];
+	NSUInteger r = rowCount++;
+	NSString *prevType = r > 0 ? types[r-1] : nil;
+	__block NSUInteger pos = 0;
+	[node enumerateChildValuesUsingBlock:^(const char *name, const char *value) {
+		// the first two are always type & Id, same as ZKSObject.
+		if (pos++ < 2) {
+			if (strcmp(name, "type") == 0) {
+				// most batches are all the one type, so share the string.
+				if (value != NULL && prevType != nil && strcmp(value, [prevType UTF8String]) == 0)
+					types[r] = [prevType retain];
+				else if (value != NULL)
+					types[r] = [[NSString alloc] initWithUTF8String:value];
+			} else if (value != NULL) {
+				ids[r] = [[NSString alloc] initWithUTF8String:value];
+			}
+			return;
+		}
+		NSUInteger col = [self columnForXmlName:name];
+		id v = value != NULL ? [[NSString alloc] initWithUTF8String:value] : [[self complexValueOfField:name inRecord:node] retain];
+		// if a field is repeated, the last one wins, same as ZKSObject.
+		[columns[col][r] release];
+		columns[col][r] = v;
+	}];
+}
+
+- (void)finishFromXmlNode:(zkElement *)node {
+	size = [[[node childElement:@"size"] stringValue] intValue];
+	NSString * strDone = [[node childElement:@"done"] stringValue];
+	done = [strDone isEqualToString:@"true"];
+	[queryLocator release];
+	queryLocator = done ? nil : [[[node childElement:@"queryLocator"] stringValue] copy];
+	// the interned names go away with the document.
+	CFDictionaryRemoveAllValues(columnsByXmlName);
+}
+
+- (NSUInteger)count {
+	return rowCount;
+}
+
+- (NSArray *)fieldNames {
+	return fieldNames;
+}
+
+// the rows are made once, the first time any of them is asked for, we don't change once we're finished.
+- (ZKRecordBatchRow **)rows {
+	@synchronized (self) {
+		if (rows == NULL) {
+			rows = malloc(MAX(rowCount, 1) * sizeof(ZKRecordBatchRow *));
+			for (NSUInteger i = 0; i < rowCount; i++)
+				rows[i] = [[ZKRecordBatchRow alloc] initWithBatch:self row:i];
+		}
+		return rows;
+	}
+}
+
+- (ZKRecordBatchRow *)rowAtIndex:(NSUInteger)row {
+	return [self rows][row];
+}
+
+// the array is new each time, as it holds onto the rows, and so us, but the rows aren't.
+// use count rather than [[batch records] count].
+- (NSArray *)records {
+	return [NSArray arrayWithObjects:(id *)[self rows] count:rowCount];
+}
+
+- (id)valueOfField:(NSString *)field atRow:(NSUInteger)row {
+	NSNumber *col = [columnIndexes objectForKey:field];
+	return col == nil ? nil : columns[[col unsignedIntegerValue]][row];
+}
+
+- (NSString *)idAtRow:(NSUInteger)row {
+	return ids[row];
+}
+
+- (NSString *)typeAtRow:(NSUInteger)row {
+	return types[row];
+}
+
+@end
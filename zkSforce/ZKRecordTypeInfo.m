@@ -22,8 +22,20 @@
 #import "ZKRecordTypeInfo.h"
 
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "available",                zkXmlBoolean },
+	{ "defaultRecordTypeMapping", zkXmlBoolean },
+	{ "name",                     zkXmlString },
+	{ "recordTypeId",             zkXmlString },
+	{ NULL, 0 }
+};
+
 @implementation ZKRecordTypeInfo
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
 - (BOOL)available {
 	return [self boolean:@"available"];
 }
@@ -24,8 +24,21 @@
 #import "ZKPicklistForRecordType.h"
 
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "available",                zkXmlBoolean },
+	{ "defaultRecordTypeMapping", zkXmlBoolean },
+	{ "recordTypeId",             zkXmlString },
+	{ "name",                     zkXmlString },
+	{ "layoutId",                 zkXmlString },
+	{ NULL, 0 }
+};
+
 @implementation ZKRecordTypeMapping
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
 -(void)dealloc {
 	[picklistsForRecordType release];
 	[super dealloc];
@@ -54,8 +67,13 @@
 - (NSArray *) picklistsForRecordType 
 {
 	if (picklistsForRecordType == nil) 
-		picklistsForRecordType = [[self complexTypeArrayFromElements:@"picklistsForRecordType" cls:[ZKRecordTypeMapping class]] retain];
+		picklistsForRecordType = [[self complexTypeArrayFromElements:@"picklistsForRecordType" cls:[ZKPicklistForRecordType class]] retain];
 	return picklistsForRecordType;
 }
 
+- (void)detach {
+	[[self picklistsForRecordType] makeObjectsPerformSelector:@selector(detach)];
+	[super detach];
+}
+
 @end
\ No newline at end of file
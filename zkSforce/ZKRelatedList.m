@@ -25,8 +25,22 @@
 #import "ZKParser.h"
 
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "custom",    zkXmlBoolean },
+	{ "field",     zkXmlString },
+	{ "name",      zkXmlString },
+	{ "label",     zkXmlString },
+	{ "sobject",   zkXmlSymbol },
+	{ "limitRows", zkXmlInteger },
+	{ NULL, 0 }
+};
+
 @implementation ZKRelatedList
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
 -(void)dealloc {
 	[columns release];
 	[sort release];
@@ -107,4 +121,10 @@
 	return [self removeLastComma:ret];
 }
 
+- (void)detach {
+	[[self columns] makeObjectsPerformSelector:@selector(detach)];
+	[[self sort] makeObjectsPerformSelector:@selector(detach)];
+	[super detach];
+}
+
 @end
\ No newline at end of file
@@ -23,8 +23,20 @@
 #import "ZKParser.h"
 
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "field",  zkXmlString },
+	{ "name",   zkXmlString },
+	{ "format", zkXmlSymbol },
+	{ "label",  zkXmlString },
+	{ NULL, 0 }
+};
+
 @implementation ZKRelatedListColumn
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
 -(NSString *) field {
 	return [self string:@"field"];
 }
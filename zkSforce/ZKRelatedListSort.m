@@ -22,8 +22,18 @@
 #import "ZKRelatedListSort.h"
 
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "ascending", zkXmlBoolean },
+	{ "column",    zkXmlString },
+	{ NULL, 0 }
+};
+
 @implementation ZKRelatedListSort
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
 -(BOOL) ascending {
 	return [self boolean:@"ascending"];
 }
@@ -34,14 +34,33 @@
 
 @end
 
+// posted (on a background thread) with the auth info as the object, once a
+// background refresh has got a new session, whose instanceUrl may have changed.
+extern NSString *const ZKSessionRefreshedInBackgroundNotification;
+
 // base class with common auth code in.
+// refreshIfNeeded is single-flight, if several threads find the session has
+// expired at the same time, one of them refreshes it and the rest wait for
+// that refresh rather than doing their own. If the session has been used
+// since it was last refreshed, it's also refreshed in the background shortly
+// before it expires, so that a regular call rarely has to wait for a refresh
+// at all. An idle session is left to expire.
 @interface ZKAuthInfoBase : NSObject <ZKAuthenticationInfo> {
     NSURL  *instanceUrl;
     NSDate *sessionExpiresAt;
     NSString *sessionId;
     NSString *clientId;
+    NSTimeInterval refreshLeadTime;
+    dispatch_queue_t refreshQueue;
+    dispatch_source_t refreshTimer;
+    BOOL refreshStopped;
+    BOOL usedSinceRefresh;
 }
 
+// how long before sessionExpiresAt to do the background refresh, defaults
+// to 60 seconds, set to 0 to turn the background refresh off.
+@property (assign) NSTimeInterval refreshLeadTime;
+
 @end
 
 // Impl of ZKAuthenticationInfo that uses an OAuth2 refresh token to generate new session Ids.
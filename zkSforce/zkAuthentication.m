@@ -27,19 +27,61 @@
 #import "PRPAlertView.h"
 
 static const int DEFAULT_MAX_SESSION_AGE = 25 * 60; // 25 minutes
+static const NSTimeInterval DEFAULT_REFRESH_LEAD_TIME = 60;
+
+NSString *const ZKSessionRefreshedInBackgroundNotification = @"ZKSessionRefreshedInBackgroundNotification";
 
 @interface ZKAuthInfoBase()
 @property (retain) NSString *sessionId;
 @property (retain) NSURL *instanceUrl;
 @property (retain) NSDate *sessionExpiresAt;
 @property (retain) NSString *clientId;
+-(void)scheduleBackgroundRefresh;
+-(void)backgroundRefresh;
+-(void)stopBackgroundRefresh;
+-(void)sessionUsed;
 @end
 
 @implementation ZKAuthInfoBase
 
-@synthesize sessionId, instanceUrl, sessionExpiresAt, clientId;
+@synthesize sessionId, instanceUrl, clientId;
+
+-(id)init {
+    self = [super init];
+    refreshLeadTime = DEFAULT_REFRESH_LEAD_TIME;
+    refreshQueue = dispatch_queue_create("zkSforce session refresh", NULL);
+    refreshTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, refreshQueue);
+    // the timer shouldn't keep us alive. dealloc stops it and waits for a refresh that's already
+    // running before anything is released, so we're around for as long as the handler is. retaining
+    // here instead could catch us part way into dealloc, and the release would free us a second time.
+    __block ZKAuthInfoBase *timerSelf = self;
+    dispatch_source_set_event_handler(refreshTimer, ^(void) {
+        @synchronized (timerSelf) {
+            if (timerSelf->refreshStopped) return;
+        }
+        [timerSelf backgroundRefresh];
+    });
+    dispatch_source_set_timer(refreshTimer, DISPATCH_TIME_FOREVER, 0, 0);
+    dispatch_resume(refreshTimer);
+    return self;
+}
+
+// subclasses call this first thing in dealloc, before they let go of anything refresh uses.
+-(void)stopBackgroundRefresh {
+    @synchronized (self) {
+        if (refreshStopped) return;
+        refreshStopped = YES;
+    }
+    dispatch_source_cancel(refreshTimer);
+    // wait for a refresh that's already running, unless we're being let go of on the refresh queue.
+    if (dispatch_get_current_queue() != refreshQueue)
+        dispatch_sync(refreshQueue, ^(void) { });
+}
 
 -(void)dealloc {
+    [self stopBackgroundRefresh];
+    dispatch_release(refreshTimer);
+    dispatch_release(refreshQueue);
     [sessionId release];
     [instanceUrl release];
     [sessionExpiresAt release];
@@ -51,12 +93,87 @@ static const int DEFAULT_MAX_SESSION_AGE = 25 * 60; // 25 minutes
     // override me!
 }
 
--(BOOL)refreshIfNeeded {
-	if (([sessionExpiresAt timeIntervalSinceNow] < 0) || (sessionId == nil)) {
-		[self refresh];    
-        return TRUE;
+-(NSDate *)sessionExpiresAt {
+    @synchronized (self) {
+        return [[sessionExpiresAt retain] autorelease];
+    }
+}
+
+-(void)setSessionExpiresAt:(NSDate *)expiresAt {
+    @synchronized (self) {
+        [sessionExpiresAt autorelease];
+        sessionExpiresAt = [expiresAt retain];
+    }
+    [self scheduleBackgroundRefresh];
+}
+
+-(NSTimeInterval)refreshLeadTime {
+    @synchronized (self) {
+        return refreshLeadTime;
+    }
+}
+
+-(void)setRefreshLeadTime:(NSTimeInterval)t {
+    @synchronized (self) {
+        refreshLeadTime = t;
+    }
+    [self scheduleBackgroundRefresh];
+}
+
+-(void)scheduleBackgroundRefresh {
+    NSDate *expiresAt = self.sessionExpiresAt;
+    NSTimeInterval lead = self.refreshLeadTime;
+    if (expiresAt == nil || lead <= 0) {
+        dispatch_source_set_timer(refreshTimer, DISPATCH_TIME_FOREVER, 0, 0);
+        return;
+    }
+    NSTimeInterval delay = MAX(0, [expiresAt timeIntervalSinceNow] - lead);
+    dispatch_source_set_timer(refreshTimer, dispatch_walltime(NULL, (int64_t)(delay * NSEC_PER_SEC)), DISPATCH_TIME_FOREVER, (uint64_t)(lead / 4 * NSEC_PER_SEC));
+}
+
+// called on refreshQueue by the timer, so it's serialized with refreshIfNeeded.
+-(void)backgroundRefresh {
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    // the expiry may have moved since the timer was set. and if nothing's used the session since
+    // the last refresh, there's nobody to save the wait for, so we don't keep an idle session alive.
+    if (usedSinceRefresh && [self.sessionExpiresAt timeIntervalSinceNow] <= self.refreshLeadTime) {
+        @try {
+            [self refresh];
+            usedSinceRefresh = NO;
+            [[NSNotificationCenter defaultCenter] postNotificationName:ZKSessionRefreshedInBackgroundNotification object:self];
+        } @catch (NSException *ex) {
+            // the next call will try again in refreshIfNeeded, and get to see the error.
+            NSLog(@"background session refresh failed %@", ex);
+        }
     }
-    return FALSE;
+    [pool release];
+}
+
+-(BOOL)refreshIfNeeded {
+    __block BOOL refreshed = NO;
+    __block NSException *error = nil;
+    // if another thread is already refreshing, this waits for it, and then finds the session is fresh.
+    dispatch_sync(refreshQueue, ^(void) {
+        if (([self.sessionExpiresAt timeIntervalSinceNow] < 0) || (self.sessionId == nil)) {
+            @try {
+                [self refresh];
+                refreshed = YES;
+            } @catch (NSException *ex) {
+                error = [ex retain];
+                return;
+            }
+        }
+        usedSinceRefresh = YES;
+        [self sessionUsed];
+    });
+    if (error != nil)
+        @throw [error autorelease];
+    return refreshed;
+}
+
+// called on refreshQueue each time refreshIfNeeded finds (or makes) a live session, for
+// subclasses whose sessions are kept alive by being used.
+-(void)sessionUsed {
 }
 
 @end
@@ -113,6 +230,7 @@ static const int DEFAULT_MAX_SESSION_AGE = 25 * 60; // 25 minutes
 }
 
 -(void)dealloc {
+    [self stopBackgroundRefresh];
     [refreshToken release];
     [authUrl release];
     [super dealloc];
@@ -143,10 +261,15 @@ static const int DEFAULT_MAX_SESSION_AGE = 25 * 60; // 25 minutes
     self.sessionExpiresAt = [NSDate dateWithTimeIntervalSinceNow:DEFAULT_MAX_SESSION_AGE];
 }
 
--(BOOL)refreshIfNeeded {
-    BOOL r = [super refreshIfNeeded];
-    self.sessionExpiresAt = [NSDate dateWithTimeIntervalSinceNow:DEFAULT_MAX_SESSION_AGE];
-    return r;
+// the session is kept alive by being used, so each call pushes the expiry back, without moving the
+// background refresh. by the time that fires, either the session has been used and the expiry has
+// moved past it, or it hasn't, and backgroundRefresh leaves it be. either way an idle app doesn't
+// refresh every 24 minutes, the next call after 25 idle ones refreshes it instead.
+-(void)sessionUsed {
+    @synchronized (self) {
+        [sessionExpiresAt autorelease];
+        sessionExpiresAt = [[NSDate dateWithTimeIntervalSinceNow:DEFAULT_MAX_SESSION_AGE] retain];
+    }
 }
 
 @end
@@ -164,6 +287,7 @@ static const int DEFAULT_MAX_SESSION_AGE = 25 * 60; // 25 minutes
 }
 
 -(void)dealloc {
+    [self stopBackgroundRefresh];
     [username release];
     [password release];
     [client release];
@@ -181,10 +305,10 @@ static const int DEFAULT_MAX_SESSION_AGE = 25 * 60; // 25 minutes
 	[env addElement:@"password" elemValue:password];
 	[env endElement:@"login"];
 	[env endElement:@"s:Body"];
-	NSString *xml = [env end];
+	NSData *xml = [env endData];
 	[env release];
 	
-	zkElement *resp = [client sendRequest:xml];	
+	zkElement *resp = [client sendRequestData:xml returnRoot:NO];
 	zkElement *result = [[resp childElements:@"result"] objectAtIndex:0];
 	ZKLoginResult *lr = [[[ZKLoginResult alloc] initWithXmlElement:result] autorelease];
 	
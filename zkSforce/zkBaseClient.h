@@ -21,14 +21,56 @@
 
 
 @class zkElement;
+@class ZKOperationStats;
+@class ZKPushParser;
+@class ZKCancellationToken;
+
+typedef void (^zkFailWithExceptionBlock)(NSException *e);
+typedef void (^zkCompleteElementBlock)(zkElement *result);
 
 @interface ZKBaseClient : NSObject {
-	NSURL *endpointUrl;
+	NSURL				*endpointUrl;
+	BOOL				compressRequests;
+	BOOL				compressResponses;
+	ZKOperationStats	*stats;
 }
 
 @property (retain) NSURL *endpointUrl;
 
+// gzip the request body, this defaults to off.
+@property (assign) BOOL compressRequests;
+
+// ask the server to gzip its responses, this defaults to off.
+@property (assign) BOOL compressResponses;
+
+// per operation counts of compressed/uncompressed bytes sent and received,
+// and timings of the queue/network/parse phases of each call.
+@property (readonly) ZKOperationStats *stats;
+
 - (zkElement *)sendRequest:(NSString *)payload;
 - (zkElement *)sendRequest:(NSString *)payload returnRoot:(BOOL)root;
 
+// As above, but the payload is the already UTF-8 encoded envelope, e.g. from ZKEnvelope endData.
+- (zkElement *)sendRequestData:(NSData *)payload returnRoot:(BOOL)root;
+// and if responseLength isn't NULL, it's set to the (uncompressed) length of the response body.
+- (zkElement *)sendRequestData:(NSData *)payload returnRoot:(BOOL)root responseLength:(NSUInteger *)responseLength;
+
+// Non-blocking versions of sendRequest, these return straight away and the
+// request is serviced from a shared network thread. The response is parsed on
+// a background queue, and then exactly one of failBlock or completeBlock is
+// called, also on a background queue. If the returned token is cancelled,
+// neither block is called.
+- (ZKCancellationToken *)sendRequest:(NSString *)payload failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteElementBlock)completeBlock;
+- (ZKCancellationToken *)sendRequest:(NSString *)payload returnRoot:(BOOL)root failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteElementBlock)completeBlock;
+
+// As above, but the response is fed to the push parser as it's read from the
+// network rather than being parsed once it's all arrived.
+- (ZKCancellationToken *)sendRequest:(NSString *)payload parser:(ZKPushParser *)parser failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteElementBlock)completeBlock;
+
+// The same calls, taking the UTF-8 encoded envelope.
+- (ZKCancellationToken *)sendRequestData:(NSData *)payload returnRoot:(BOOL)root failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteElementBlock)completeBlock;
+- (ZKCancellationToken *)sendRequestData:(NSData *)payload parser:(ZKPushParser *)parser failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteElementBlock)completeBlock;
+// and the complete block also gets the (uncompressed) length of the response body.
+- (ZKCancellationToken *)sendRequestData:(NSData *)payload returnRoot:(BOOL)root failBlock:(zkFailWithExceptionBlock)failBlock lengthBlock:(void (^)(zkElement *result, NSUInteger length))completeBlock;
+
 @end
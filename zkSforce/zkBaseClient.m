@@ -22,15 +22,33 @@
 #import "zkBaseClient.h"
 #import "zkSoapException.h"
 #import "zkParser.h"
+#import "ZKHttpRequest.h"
+#import "ZKGzip.h"
+#import "ZKOperationStats.h"
+#import "ZKCancellationToken.h"
+
+@interface ZKBaseClient ()
+- (NSMutableURLRequest *)makeRequest:(NSData *)data;
+- (void)recordOperation:(NSData *)payload request:(ZKHttpRequest *)r uncompressedLength:(NSUInteger)reqLength
+		 responseLength:(NSUInteger)respLength parseTime:(NSTimeInterval)parseTime;
+- (zkElement *)processRoot:(zkElement *)root response:(NSHTTPURLResponse *)resp returnRoot:(BOOL)returnRoot;
+@end
 
 @implementation ZKBaseClient
 
 static NSString *SOAP_NS = @"http://schemas.xmlsoap.org/soap/envelope/";
 
-@synthesize endpointUrl;
+@synthesize endpointUrl, compressRequests, compressResponses, stats;
+
+- (id)init {
+	self = [super init];
+	stats = [[ZKOperationStats alloc] init];
+	return self;
+}
 
 - (void)dealloc {
 	[endpointUrl release];
+	[stats release];
 	[super dealloc];
 }
 
@@ -38,22 +56,165 @@ static NSString *SOAP_NS = @"http://schemas.xmlsoap.org/soap/envelope/";
 	return [self sendRequest:payload returnRoot:NO];
 }
 
-- (zkElement *)sendRequest:(NSString *)payload returnRoot:(BOOL)returnRoot {
+- (NSMutableURLRequest *)makeRequest:(NSData *)data {
 	NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:endpointUrl];
 	[request setHTTPMethod:@"POST"];
 	[request addValue:@"text/xml; charset=UTF-8" forHTTPHeaderField:@"content-type"];	
 	[request addValue:@"\"\"" forHTTPHeaderField:@"SOAPAction"];
+	if (compressRequests) {
+		data = [ZKGzip gzipData:data];
+		[request addValue:@"gzip" forHTTPHeaderField:@"Content-Encoding"];
+	}
+	if (compressResponses)
+		[request addValue:@"gzip" forHTTPHeaderField:@"Accept-Encoding"];
 	
-	NSData *data = [payload dataUsingEncoding:NSUTF8StringEncoding];
 	[request setHTTPBody:data];
-	
-	NSHTTPURLResponse *resp = nil;
-	NSError *err = nil;
-	// todo, support request compression
-	// todo, support response compression
-	NSData *respPayload = [NSURLConnection sendSynchronousRequest:request returningResponse:&resp error:&err];
-	//NSLog(@"response \r\n%@", [NSString stringWithCString:[respPayload bytes] length:[respPayload length]]);
-	zkElement *root = [zkParser parseData:respPayload];
+	return request;
+}
+
+- (void)recordOperation:(NSData *)payload request:(ZKHttpRequest *)r uncompressedLength:(NSUInteger)reqLength
+		 responseLength:(NSUInteger)respLength parseTime:(NSTimeInterval)parseTime {
+	NSString *op = [ZKOperationStats operationNameForEnvelopeData:payload];
+	// if NSURLConnection decompressed the response for us, then the Content-Length header is the only place to get the on the wire size from.
+	NSUInteger wireLength = [r bytesReceived];
+	NSDictionary *headers = [[r response] allHeaderFields];
+	if ([[headers objectForKey:@"Content-Encoding"] rangeOfString:@"gzip"].location != NSNotFound) {
+		long long contentLength = [[headers objectForKey:@"Content-Length"] longLongValue];
+		if (contentLength > 0)
+			wireLength = (NSUInteger)contentLength;
+	}
+	[stats recordOperation:op
+			  requestBytes:[[[r request] HTTPBody] length] uncompressed:reqLength
+			 responseBytes:wireLength uncompressed:respLength];
+	[stats recordPhase:ZKOperationPhaseQueued ofOperation:op duration:[r startedAt] - [r queuedAt]];
+	[stats recordPhase:ZKOperationPhaseFirstByte ofOperation:op duration:[r firstByteAt] - [r startedAt]];
+	[stats recordPhase:ZKOperationPhaseLastByte ofOperation:op duration:[r finishedAt] - [r firstByteAt]];
+	[stats recordPhase:ZKOperationPhaseParse ofOperation:op duration:parseTime];
+}
+
+- (zkElement *)sendRequest:(NSString *)payload returnRoot:(BOOL)returnRoot {
+	return [self sendRequestData:[payload dataUsingEncoding:NSUTF8StringEncoding] returnRoot:returnRoot];
+}
+
+- (zkElement *)sendRequestData:(NSData *)payload returnRoot:(BOOL)returnRoot {
+	return [self sendRequestData:payload returnRoot:returnRoot responseLength:NULL];
+}
+
+- (zkElement *)sendRequestData:(NSData *)payload returnRoot:(BOOL)returnRoot responseLength:(NSUInteger *)responseLength {
+	// go through the shared transport, so that blocking calls count against the same per host limit as everything else.
+	__block zkElement *result = nil;
+	__block NSException *error = nil;
+	__block NSUInteger length = 0;
+	dispatch_semaphore_t done = dispatch_semaphore_create(0);
+	[self sendRequestData:payload returnRoot:returnRoot failBlock:^(NSException *ex) {
+		error = [ex retain];
+		dispatch_semaphore_signal(done);
+	} lengthBlock:^(zkElement *r, NSUInteger len) {
+		result = [r retain];
+		length = len;
+		dispatch_semaphore_signal(done);
+	}];
+	dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+	dispatch_release(done);
+	if (error != nil)
+		@throw [error autorelease];
+	if (responseLength != NULL)
+		*responseLength = length;
+	return [result autorelease];
+}
+
+- (ZKCancellationToken *)sendRequest:(NSString *)payload failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteElementBlock)completeBlock {
+	return [self sendRequest:payload returnRoot:NO failBlock:failBlock completeBlock:completeBlock];
+}
+
+- (ZKCancellationToken *)sendRequest:(NSString *)payload returnRoot:(BOOL)returnRoot failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteElementBlock)completeBlock {
+	return [self sendRequestData:[payload dataUsingEncoding:NSUTF8StringEncoding] returnRoot:returnRoot failBlock:failBlock completeBlock:completeBlock];
+}
+
+- (ZKCancellationToken *)sendRequestData:(NSData *)payload returnRoot:(BOOL)returnRoot failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteElementBlock)completeBlock {
+	return [self sendRequestData:payload returnRoot:returnRoot failBlock:failBlock lengthBlock:^(zkElement *result, NSUInteger length) {
+		completeBlock(result);
+	}];
+}
+
+- (ZKCancellationToken *)sendRequestData:(NSData *)payload returnRoot:(BOOL)returnRoot failBlock:(zkFailWithExceptionBlock)failBlock lengthBlock:(void (^)(zkElement *result, NSUInteger length))completeBlock {
+	ZKHttpRequest *req = [ZKHttpRequest requestWithURLRequest:[self makeRequest:payload] completionBlock:^(ZKHttpRequest *r, NSError *err) {
+		if ([r isCancelled]) return;
+		zkElement *root = nil;
+		CFAbsoluteTime parseStart = CFAbsoluteTimeGetCurrent();
+		if ([r responseData] != nil)
+			root = [zkParser parseData:[r responseData]];
+		[self recordOperation:payload request:r uncompressedLength:[payload length] responseLength:[[r responseData] length] parseTime:CFAbsoluteTimeGetCurrent() - parseStart];
+		zkElement *result = nil;
+		@try {
+			if (err != nil && [r responseData] == nil)
+				@throw [NSException exceptionWithName:@"Network error" reason:[err localizedDescription] userInfo:[err userInfo]];
+			result = [self processRoot:root response:[r response] returnRoot:returnRoot];
+		} @catch (NSException *ex) {
+			failBlock(ex);
+			return;
+		}
+		completeBlock(result, [[r responseData] length]);
+	}];
+	[req start];
+	ZKCancellationToken *token = [ZKCancellationToken token];
+	[token addCancelHandler:^(void) {
+		[req cancel];
+	}];
+	return token;
+}
+
+- (ZKCancellationToken *)sendRequest:(NSString *)payload parser:(ZKPushParser *)parser failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteElementBlock)completeBlock {
+	return [self sendRequestData:[payload dataUsingEncoding:NSUTF8StringEncoding] parser:parser failBlock:failBlock completeBlock:completeBlock];
+}
+
+- (ZKCancellationToken *)sendRequestData:(NSData *)payload parser:(ZKPushParser *)parser failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteElementBlock)completeBlock {
+	// chunks are parsed in order on their own queue, so that parsing overlaps with reading the rest of the response.
+	dispatch_queue_t parseQueue = dispatch_queue_create("zkSforce parser", NULL);
+	ZKHttpRequest *req = [ZKHttpRequest requestWithURLRequest:[self makeRequest:payload] completionBlock:^(ZKHttpRequest *r, NSError *err) {
+		dispatch_async(parseQueue, ^(void) {
+			if ([r isCancelled]) return;
+			zkElement *root = nil;
+			NSException *parseError = nil;
+			if (err == nil) {
+				@try {
+					root = [parser finish];
+				} @catch (NSException *ex) {
+					parseError = ex;
+				}
+			}
+			// the time spent in the element block is decoding, not parsing, the caller accounts for that.
+			[self recordOperation:payload request:r uncompressedLength:[payload length] responseLength:[parser bytesParsed] parseTime:[parser parseTime] - [parser elementBlockTime]];
+			zkElement *result = nil;
+			@try {
+				if (err != nil)
+					@throw [NSException exceptionWithName:@"Network error" reason:[err localizedDescription] userInfo:[err userInfo]];
+				if (parseError != nil)
+					@throw parseError;
+				result = [self processRoot:root response:[r response] returnRoot:NO];
+			} @catch (NSException *ex) {
+				failBlock(ex);
+				return;
+			}
+			completeBlock(result);
+		});
+		dispatch_release(parseQueue);
+	}];
+	[req setDataBlock:^(ZKHttpRequest *r, NSData *chunk) {
+		dispatch_async(parseQueue, ^(void) {
+			[parser parseChunk:chunk];
+		});
+	}];
+	[req start];
+	ZKCancellationToken *token = [ZKCancellationToken token];
+	[token addCancelHandler:^(void) {
+		[parser abort];
+		[req cancel];
+	}];
+	return token;
+}
+
+- (zkElement *)processRoot:(zkElement *)root response:(NSHTTPURLResponse *)resp returnRoot:(BOOL)returnRoot {
 	if (root == nil)	
 		@throw [NSException exceptionWithName:@"Xml error" reason:@"Unable to parse XML returned by server" userInfo:nil];
 	if (![[root name] isEqualToString:@"Envelope"])
@@ -22,8 +22,20 @@
 
 #import "zkChildRelationship.h"
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "cascadeDelete",    zkXmlBoolean },
+	{ "childSObject",     zkXmlSymbol },
+	{ "field",            zkXmlString },
+	{ "relationshipName", zkXmlString },
+	{ NULL, 0 }
+};
+
 @implementation ZKChildRelationship
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
 -(BOOL)cascadeDelete {
 	return [self boolean:@"cascadeDelete"];
 }
@@ -22,29 +22,71 @@
 
 #import "zkDescribeField.h"
 #import "zkPicklistEntry.h"
+#import "zkDescribeSObject.h"
 #import "zkParser.h"
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "autoNumber",              zkXmlBoolean },
+	{ "byteLength",              zkXmlInteger },
+	{ "calculated",              zkXmlBoolean },
+	{ "controllerName",          zkXmlString },
+	{ "createable",              zkXmlBoolean },
+	{ "custom",                  zkXmlBoolean },
+	{ "dependentPicklist",       zkXmlBoolean },
+	{ "digits",                  zkXmlInteger },
+	{ "externalId",              zkXmlBoolean },
+	{ "filterable",              zkXmlBoolean },
+	{ "htmlFormatted",           zkXmlBoolean },
+	{ "label",                   zkXmlString },
+	{ "length",                  zkXmlInteger },
+	{ "name",                    zkXmlString },
+	{ "nameField",               zkXmlBoolean },
+	{ "nillable",                zkXmlBoolean },
+	{ "precision",               zkXmlInteger },
+	{ "relationshipName",        zkXmlString },
+	{ "restrictedPicklist",      zkXmlBoolean },
+	{ "scale",                   zkXmlInteger },
+	{ "soapType",                zkXmlSymbol },
+	{ "type",                    zkXmlSymbol },
+	{ "updateable",              zkXmlBoolean },
+	{ "calculatedFormula",       zkXmlString },
+	{ "caseSensitive",           zkXmlBoolean },
+	{ "defaultValueFormula",     zkXmlString },
+	{ "namePointing",            zkXmlBoolean },
+	{ "sortable",                zkXmlBoolean },
+	{ "unique",                  zkXmlBoolean },
+	{ "idLookup",                zkXmlBoolean },
+	{ "relationshipOrder",       zkXmlInteger },
+	{ "writeRequiresMasterRead", zkXmlBoolean },
+	{ "inlineHelpText",          zkXmlString },
+	{ "groupable",               zkXmlBoolean },
+	{ "defaultOnCreate",         zkXmlBoolean },
+	{ NULL, 0 }
+};
+
 @implementation ZKDescribeField
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
 - (void)dealloc {
 	[picklistValues release];
 	[super dealloc];
 }
 
+// we're immutable, so a copy can just be us, this also means it works once we've been detached.
 - (id)copyWithZone:(NSZone *)zone {
-	zkElement *n = [[node copyWithZone:zone] autorelease];
-	ZKDescribeField *rhs = [[ZKDescribeField alloc] initWithXmlElement:n];
-	[rhs setSobject:sobject];
-	return rhs;
-}
-
-- (zkElement *)node {
-	return node;
+	return [self retain];
 }
 
+// a field is identified by its name and the name of the sobject it's on.
 - (BOOL)isEqual:(id)anObject {
+	if (anObject == self) return YES;
 	if (![anObject isKindOfClass:[ZKDescribeField class]]) return NO;
-	return [node isEqual:[anObject node]];
+	if (![[self name] isEqualToString:[anObject name]]) return NO;
+	NSString *sobjectName = [sobject name], *rhsSobjectName = [[anObject sobject] name];
+	return sobjectName == rhsSobjectName || [sobjectName isEqualToString:rhsSobjectName];
 }
 
 - (void)setSobject:(ZKDescribeSObject *)s {
@@ -58,7 +100,7 @@
 }
 
 - (NSUInteger)hash {
-	return [node hash];
+	return [[self name] hash];
 }
 - (BOOL)autoNumber {
 	return [self boolean:@"autoNumber"];
@@ -177,4 +219,10 @@
 	return [self boolean:@"groupable"];
 }
 
+- (void)detach {
+	[self referenceTo];
+	[[self picklistValues] makeObjectsPerformSelector:@selector(detach)];
+	[super detach];
+}
+
 @end
@@ -22,8 +22,36 @@
 #import "zkDescribeGlobalSObject.h"
 
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "activateable",        zkXmlBoolean },
+	{ "createable",          zkXmlBoolean },
+	{ "custom",              zkXmlBoolean },
+	{ "customSetting",       zkXmlBoolean },
+	{ "deletable",           zkXmlBoolean },
+	{ "deprecatedAndHidden", zkXmlBoolean },
+	{ "feedEnabled",         zkXmlBoolean },
+	{ "layoutable",          zkXmlBoolean },
+	{ "mergeable",           zkXmlBoolean },
+	{ "queryable",           zkXmlBoolean },
+	{ "replicateable",       zkXmlBoolean },
+	{ "retrieveable",        zkXmlBoolean },
+	{ "searchable",          zkXmlBoolean },
+	{ "triggerable",         zkXmlBoolean },
+	{ "undeleteable",        zkXmlBoolean },
+	{ "updateable",          zkXmlBoolean },
+	{ "keyPrefix",           zkXmlString },
+	{ "label",               zkXmlString },
+	{ "labelPlural",         zkXmlString },
+	{ "name",                zkXmlString },
+	{ NULL, 0 }
+};
+
 @implementation ZKDescribeGlobalSObject
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
 -(BOOL)activateable {
 	return [self boolean:@"activateable"];
 }
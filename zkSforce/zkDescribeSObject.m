@@ -26,8 +26,19 @@
 #import "zkRecordTypeInfo.h"
 #import "zkParser.h"
 
+static const ZKXmlFieldDef fieldDefs[] = {
+	{ "urlDetail", zkXmlString },
+	{ "urlEdit",   zkXmlString },
+	{ "urlNew",    zkXmlString },
+	{ NULL, 0 }
+};
+
 @implementation ZKDescribeSObject
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return fieldDefs;
+}
+
 -(void)dealloc {
 	[fields release];
 	[fieldsByName release];
@@ -103,4 +114,11 @@
 	return recordTypeInfos;
 }
 
+- (void)detach {
+	[[self fields] makeObjectsPerformSelector:@selector(detach)];
+	[[self childRelationships] makeObjectsPerformSelector:@selector(detach)];
+	[[self recordTypeInfos] makeObjectsPerformSelector:@selector(detach)];
+	[super detach];
+}
+
 @end
@@ -22,8 +22,12 @@
 
 #import "zkSObject.h"
 
+// Builds up a SOAP envelope as UTF-8 bytes, which can be handed straight
+// to the HTTP request as its body, without ever building an NSString.
 @interface ZKEnvelope : NSObject {
-	NSMutableString 	*env;
+	char				*buf;
+	NSUInteger			length, capacity;
+	NSData				*result;
 	int					state;
 }
 
@@ -31,6 +35,7 @@
 - (void)writeSessionHeader:(NSString *)sessionId;
 - (void)writeCallOptionsHeader:(NSString *)callOptions;
 - (void)writeMruHeader:(BOOL)updateMru;
+- (void)writeQueryOptionsHeader:(int)batchSize;
 
 - (void) moveToBody;
 - (void) startElement:(NSString *)elemName;
@@ -38,6 +43,8 @@
 - (void) writeText:(NSString *)text;
 - (void) addElement:(NSString *)elemName elemValue:(id)elemValue;
 - (NSString *)end;
+// finishes the envelope, and returns it as UTF-8, after this the envelope can't be added to.
+- (NSData *)endData;
 
 - (void) addElementArray:(NSString *)elemName   elemValue:(NSArray *)elemValues;
 - (void) addElementSObject:(NSString *)elemName elemValue:(ZKSObject *)sobject;
@@ -22,6 +22,12 @@
 
 #import "zkEnvelope.h"
 
+@interface ZKEnvelope ()
+- (void)appendBytes:(const char *)bytes length:(NSUInteger)len;
+- (void)appendEscapedBytes:(const char *)bytes length:(NSUInteger)len;
+- (void)appendString:(NSString *)s escaped:(BOOL)escape;
+@end
+
 @implementation ZKEnvelope
 
 enum envState {
@@ -30,9 +36,94 @@ enum envState {
 	inBody = 3
 };
 
+// writes a string literal without having to measure it, or turn it into an NSString.
+#define APPEND_LITERAL(lit) [self appendBytes:lit length:sizeof(lit) - 1]
+
+// what writeText replaces each character with, NULL for ones that are copied straight through.
+static const char *escapes[256] = {
+	['<'] = "&lt;",
+	['>'] = "&gt;",
+	['&'] = "&amp;",
+};
+
+- (void)dealloc {
+	free(buf);
+	[result release];
+	[super dealloc];
+}
+
+- (void)ensureSpace:(NSUInteger)needed {
+	if (result != nil)
+		@throw [NSException exceptionWithName:@"Illegal State Exception" reason:@"Unable to write to an envelope once it's ended" userInfo:nil];
+	if (length + needed <= capacity) return;
+	NSUInteger cap = MAX(capacity * 2, 2048);
+	while (cap < length + needed)
+		cap *= 2;
+	buf = realloc(buf, cap);
+	capacity = cap;
+}
+
+- (void)appendBytes:(const char *)bytes length:(NSUInteger)len {
+	[self ensureSpace:len];
+	memcpy(buf + length, bytes, len);
+	length += len;
+}
+
+// copies runs of characters that don't need escaping in one go.
+- (void)appendEscapedBytes:(const char *)bytes length:(NSUInteger)len {
+	const char *p = bytes, *end = bytes + len;
+	while (p < end) {
+		const char *run = p;
+		while (p < end && escapes[(unsigned char)*p] == NULL)
+			p++;
+		[self appendBytes:run length:p - run];
+		if (p < end) {
+			const char *e = escapes[(unsigned char)*p++];
+			[self appendBytes:e length:strlen(e)];
+		}
+	}
+}
+
+// most strings can hand us their UTF-8 bytes directly, the rest are converted
+// straight into the buffer, or via a scratch buffer if they need escaping.
+- (void)appendString:(NSString *)s escaped:(BOOL)escape {
+	if (s == nil) return;
+	CFStringRef str = (CFStringRef)s;
+	const char *src = CFStringGetCStringPtr(str, kCFStringEncodingUTF8);
+	if (src == NULL)
+		src = CFStringGetCStringPtr(str, kCFStringEncodingASCII);
+	if (src != NULL) {
+		if (escape)
+			[self appendEscapedBytes:src length:strlen(src)];
+		else
+			[self appendBytes:src length:strlen(src)];
+		return;
+	}
+	CFIndex chars = CFStringGetLength(str), used = 0;
+	CFIndex maxBytes = CFStringGetMaximumSizeForEncoding(chars, kCFStringEncodingUTF8);
+	if (!escape) {
+		[self ensureSpace:maxBytes];
+		CFStringGetBytes(str, CFRangeMake(0, chars), kCFStringEncodingUTF8, 0, false, (UInt8 *)buf + length, maxBytes, &used);
+		length += used;
+		return;
+	}
+	char stackBuf[1024];
+	char *scratch = maxBytes <= (CFIndex)sizeof(stackBuf) ? stackBuf : malloc(maxBytes);
+	CFStringGetBytes(str, CFRangeMake(0, chars), kCFStringEncodingUTF8, 0, false, (UInt8 *)scratch, maxBytes, &used);
+	[self appendEscapedBytes:scratch length:used];
+	if (scratch != stackBuf)
+		free(scratch);
+}
+
 - (void)start:(NSString *)primaryNamespceUri {
-	[env release];
-	env = [NSMutableString stringWithFormat:@"<s:Envelope xmlns:s='http://schemas.xmlsoap.org/soap/envelope/' xmlns='%@'>", primaryNamespceUri];
+	free(buf);
+	buf = NULL;
+	length = capacity = 0;
+	[result release];
+	result = nil;
+	APPEND_LITERAL("<s:Envelope xmlns:s='http://schemas.xmlsoap.org/soap/envelope/' xmlns='");
+	[self appendString:primaryNamespceUri escaped:NO];
+	APPEND_LITERAL("'>");
 	state = inEnvelope;
 }
 
@@ -40,39 +131,48 @@ enum envState {
 	if (state == inBody)
 		@throw [NSException exceptionWithName:@"Illegal State Exception" reason:@"Unable to write headers once we've moved to the body" userInfo:nil];
 	if (state == inHeaders) return;
-	[self startElement:@"s:Header"];
+	APPEND_LITERAL("<s:Header>");
 	state = inHeaders;
 }
 
 - (void)writeSessionHeader:(NSString *)sessionId {
 	if ([sessionId length] == 0) return;
 	[self moveToHeaders];
-	[self startElement:@"SessionHeader"];
-	[self addElement:@"sessionId" elemValue:sessionId];
-	[self endElement:@"SessionHeader"];
+	APPEND_LITERAL("<SessionHeader><sessionId>");
+	[self writeText:sessionId];
+	APPEND_LITERAL("</sessionId></SessionHeader>");
 }
 
 - (void)writeCallOptionsHeader:(NSString *)clientId {
 	if ([clientId length] == 0) return;
 	[self moveToHeaders];
-	[self startElement:@"CallOptions"];
-	[self addElement:@"client" elemValue:clientId];
-	[self endElement:@"CallOptions"];
+	APPEND_LITERAL("<CallOptions><client>");
+	[self writeText:clientId];
+	APPEND_LITERAL("</client></CallOptions>");
 }
 
 - (void)writeMruHeader:(BOOL)updateMru {
 	if (!updateMru) return;
 	[self moveToHeaders];
-	[self startElement:@"MruHeader"];
-	[self addElement:@"updateMru" elemValue:@"true"];
-	[self endElement:@"MruHeader"];
+	APPEND_LITERAL("<MruHeader><updateMru>true</updateMru></MruHeader>");
+}
+
+// a batchSize of 0 means use the server's default, so there's no header to write.
+- (void)writeQueryOptionsHeader:(int)batchSize {
+	if (batchSize <= 0) return;
+	[self moveToHeaders];
+	char size[16];
+	int len = snprintf(size, sizeof(size), "%d", batchSize);
+	APPEND_LITERAL("<QueryOptions><batchSize>");
+	[self appendBytes:size length:len];
+	APPEND_LITERAL("</batchSize></QueryOptions>");
 }
 
 - (void) moveToBody {
 	if (state == inHeaders)
-		[self endElement:@"s:Header"];
+		APPEND_LITERAL("</s:Header>");
 	if (state != inBody) 
-		[self startElement:@"s:Body"];
+		APPEND_LITERAL("<s:Body>");
 	state = inBody;
 }
 
@@ -110,32 +210,35 @@ enum envState {
 }
 
 - (void) writeText:(NSString *)text  {
-	unichar c;
-	NSUInteger i, len = [text length];
-	for (i = 0; i < len; i++)
-	{
-		c = [text characterAtIndex:i];
-		switch (c)
-		{
-			case '<' : [env appendString:@"&lt;"]; break;
-			case '>' : [env appendString:@"&gt;"]; break;
-			case '&' : [env appendString:@"&amp;"]; break;
-			default  : [env appendFormat:@"%C", c];
-		}
-	}
+	[self appendString:text escaped:YES];
 }
 
 - (void )startElement:(NSString *)elemName {
-	[env appendFormat:@"<%@>", elemName];
+	APPEND_LITERAL("<");
+	[self appendString:elemName escaped:NO];
+	APPEND_LITERAL(">");
 }
 
 - (void )endElement:(NSString *)elemName {
-	[env appendFormat:@"</%@>", elemName];
+	APPEND_LITERAL("</");
+	[self appendString:elemName escaped:NO];
+	APPEND_LITERAL(">");
+}
+
+- (NSData *)endData {
+	if (result == nil) {
+		APPEND_LITERAL("</s:Envelope>");
+		// hand the buffer over to the NSData rather than copying it.
+		buf = realloc(buf, length);
+		result = [[NSData alloc] initWithBytesNoCopy:buf length:length freeWhenDone:YES];
+		buf = NULL;
+		capacity = 0;
+	}
+	return [[result retain] autorelease];
 }
 
 - (NSString *)end {
-	[env appendString:@"</s:Envelope>"];
-	return env;
+	return [[[NSString alloc] initWithData:[self endData] encoding:NSUTF8StringEncoding] autorelease];
 }
 
 @end
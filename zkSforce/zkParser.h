@@ -26,6 +26,8 @@
 	xmlDocPtr	doc;
 	xmlNodePtr	node;
 	zkElement	*parent;
+	CFMutableDictionaryRef	childIndex;	// interned child name -> first child element with that name.
+	volatile int32_t	lookups;
 }
 - (NSString *)name;
 - (NSString *)namespace;
@@ -36,9 +38,65 @@
 - (NSArray *)childElements:(NSString *)name ns:(NSString *)namespace;
 - (NSArray *)childElements;
 - (NSString *)attributeValue:(NSString *)name ns:(NSString *)namespace;
+
+// Calls the block for each child element in document order. Rather than
+// creating an object per child, a single zkElement is moved along the
+// children, so it's only valid until the block returns, copy it if you
+// need to keep it.
+- (void)enumerateChildElementsUsingBlock:(void (^)(zkElement *child, BOOL *stop))block;
+
+// Calls the block with the UTF8 name and text of each child element, for
+// decoders that don't want to build an NSString for every value. The text is
+// NULL if the child is empty or has child elements of its own. Both are only
+// valid until the block returns.
+- (void)enumerateChildValuesUsingBlock:(void (^)(const char *name, const char *value))block;
+
+// Serializes this element and its children as a standalone UTF8 XML document,
+// any namespaces declared by its ancestors are declared on the new root, so
+// the result can be handed back to zkParser parseData: later on.
+- (NSData *)xmlData;
 @end;
 
 @interface zkParser : NSObject {
 }
 +(zkElement *)parseData:(NSData *)data;
 @end
+
+typedef void (^zkElementBlock)(zkElement *e);
+
+// Parses a document incrementally as its bytes arrive. Elements with the
+// given local name at the given depth (the root element is depth 1) are
+// passed to the block as soon as their end tag is read, and are never added
+// to the document, so only one of them is ever held in memory. (any comments
+// inside them are dropped.)
+// The element is only valid until the block returns. The block is called on whichever thread calls parseChunk:.
+@interface ZKPushParser : NSObject {
+	xmlParserCtxtPtr	ctx;
+	xmlChar				*streamedName;
+	int					streamedDepth;
+	xmlNodePtr			streamedNode;		// the streamed element being built, and where in it we've got to.
+	xmlNodePtr			streamedCurrent;
+	zkElementBlock		elementBlock;
+	NSException			*blockException;
+	NSUInteger			bytesParsed;
+	NSTimeInterval		parseTime;
+	NSTimeInterval		elementBlockTime;
+	volatile BOOL		aborted;
+}
+- (id)initWithStreamedElement:(NSString *)name depth:(int)depth block:(zkElementBlock)block;
+
+- (void)parseChunk:(NSData *)data;
+
+// can be called from any thread, stops the parse at the next element, and any chunks after that are ignored.
+- (void)abort;
+
+// Returns the root element of what's left of the document, or nil if it
+// wasn't well formed. If the element block threw, that exception is
+// re-thrown from here.
+- (zkElement *)finish;
+
+@property (readonly) NSUInteger bytesParsed;
+// time spent parsing so far, including the time spent in the element block, which is also tracked on its own.
+@property (readonly) NSTimeInterval parseTime;
+@property (readonly) NSTimeInterval elementBlockTime;
+@end
@@ -20,6 +20,15 @@
 //
 
 #import "zkParser.h"
+#include <libxml/SAX2.h>
+#include <libkern/OSAtomic.h>
+
+// constant strings already have a UTF8 buffer we can use, so only build one if we have to.
+static const xmlChar *utf8(NSString *s) {
+	if (s == nil) return NULL;
+	const char *c = CFStringGetCStringPtr((CFStringRef)s, kCFStringEncodingUTF8);
+	return (const xmlChar *)(c != NULL ? c : [s UTF8String]);
+}
 
 @implementation zkElement
 
@@ -45,6 +54,7 @@
 
 -(void)dealloc {
 	[parent release];
+	if (childIndex != NULL) CFRelease(childIndex);
 	xmlFreeDoc(doc);
 	[super dealloc];
 }
@@ -74,13 +84,57 @@
 	return sv;
 }
 
+// used by the enumeration cursor to move along to its next sibling.
+- (void)moveToNode:(xmlNodePtr)n {
+	node = n;
+	lookups = 0;
+	if (childIndex != NULL) {
+		CFRelease(childIndex);
+		childIndex = NULL;
+	}
+}
+
+- (void)buildChildIndex {
+	CFMutableDictionaryRef idx = CFDictionaryCreateMutable(NULL, 0, NULL, NULL);
+	for (xmlNodePtr cur = node->xmlChildrenNode; cur != NULL; cur = cur->next) {
+		if (cur->type == XML_ELEMENT_NODE && !CFDictionaryContainsKey(idx, cur->name))
+			CFDictionarySetValue(idx, cur->name, cur);
+	}
+	// another thread may have got there first, in which case we use theirs.
+	if (!OSAtomicCompareAndSwapPtrBarrier(NULL, idx, (void * volatile *)&childIndex))
+		CFRelease(idx);
+}
+
+// The first child element with this name, which must be the document's
+// interned copy of it. The first couple of lookups just scan the children,
+// after that we index them so that repeated lookups on the same element don't.
+// Like the index, the count can be shared by several threads.
+- (xmlNodePtr)firstChildNamed:(const xmlChar *)n {
+	if (childIndex == NULL && OSAtomicIncrement32(&lookups) > 2)
+		[self buildChildIndex];
+	if (childIndex != NULL)
+		return (xmlNodePtr)CFDictionaryGetValue(childIndex, n);
+	xmlNodePtr cur = node->xmlChildrenNode;
+	while (cur != NULL && (cur->name != n || cur->type != XML_ELEMENT_NODE))
+		cur = cur->next;
+	return cur;
+}
+
 - (id)childElements:(NSString *)name ns:(NSString *)namespace checkNs:(BOOL)checkNs all:(BOOL)returnAll {
 	NSMutableArray *results = returnAll ? [NSMutableArray array] : nil;
-	const xmlChar * n = (const xmlChar *)[name UTF8String];
-	const xmlChar * ns = (const xmlChar *)[namespace UTF8String];
+	const xmlChar * n = utf8(name);
+	const xmlChar * ns = utf8(namespace);
 	xmlNodePtr cur = node->xmlChildrenNode;
+	xmlDictPtr dict = node->doc == NULL ? NULL : node->doc->dict;
+	if (n != NULL && dict != NULL) {
+		// the parser interns element names in the document's dictionary, if the name isn't
+		// in there no child can have it, otherwise comparing the pointers is enough.
+		n = xmlDictExists(dict, n, -1);
+		if (n == NULL) return results;
+		cur = [self firstChildNamed:n];
+	}
 	while (cur != NULL) {
-		if ((n == NULL) || (!xmlStrcmp(cur->name, n))) {
+		if ((n == NULL) || (dict != NULL ? cur->name == n : !xmlStrcmp(cur->name, n))) {
 			if((!checkNs) || (!xmlStrcmp(cur->ns->href, ns))) {
 				zkElement *e = [[[zkElement alloc] initWithNode:cur parent:self] autorelease]; 
 				if (!returnAll) return e;
@@ -112,6 +166,53 @@
 	return [self childElements:nil ns:nil checkNs:NO all:YES];
 }
 
+- (void)enumerateChildElementsUsingBlock:(void (^)(zkElement *child, BOOL *stop))block {
+	zkElement *cursor = nil;
+	BOOL stop = NO;
+	for (xmlNodePtr cur = node->xmlChildrenNode; cur != NULL && !stop; cur = cur->next) {
+		if (cur->type != XML_ELEMENT_NODE) continue;
+		if (cursor == nil)
+			cursor = [[zkElement alloc] initWithNode:cur parent:self];
+		else
+			[cursor moveToNode:cur];
+		block(cursor, &stop);
+	}
+	[cursor release];
+}
+
+- (void)enumerateChildValuesUsingBlock:(void (^)(const char *name, const char *value))block {
+	for (xmlNodePtr cur = node->xmlChildrenNode; cur != NULL; cur = cur->next) {
+		if (cur->type != XML_ELEMENT_NODE) continue;
+		xmlNodePtr text = cur->xmlChildrenNode;
+		if (text == NULL) {
+			block((const char *)cur->name, NULL);
+		} else if (text->next == NULL && text->type == XML_TEXT_NODE) {
+			// the usual case, a single text node we can use as is.
+			block((const char *)cur->name, (const char *)text->content);
+		} else {
+			BOOL simple = YES;
+			for (xmlNodePtr c = text; c != NULL && simple; c = c->next)
+				simple = c->type != XML_ELEMENT_NODE;
+			xmlChar *v = simple ? xmlNodeListGetString(cur->doc, text, 1) : NULL;
+			block((const char *)cur->name, (const char *)v);
+			xmlFree(v);
+		}
+	}
+}
+
+- (NSData *)xmlData {
+	xmlDocPtr copy = xmlNewDoc((const xmlChar *)"1.0");
+	xmlDocSetRootElement(copy, xmlDocCopyNode(node, copy, 1));
+	xmlChar *buf = NULL;
+	int len = 0;
+	xmlDocDumpMemoryEnc(copy, &buf, &len, "UTF-8");
+	xmlFreeDoc(copy);
+	if (buf == NULL) return nil;
+	NSData *d = [NSData dataWithBytes:buf length:len];
+	xmlFree(buf);
+	return d;
+}
+
 @end
 
 @implementation zkParser
@@ -124,3 +225,190 @@
 }
 
 @end
+
+@implementation ZKPushParser
+
+@synthesize bytesParsed, parseTime, elementBlockTime;
+
+// the default SAX2 handlers build the tree as normal, except for the streamed elements. Those are
+// built by the handlers below, as a subtree of their own that's never linked into the document, so
+// it can be handed to the block and freed when it ends, without the tree builder ever seeing it.
+static xmlNsPtr streamedNs(ZKPushParser *parser, xmlNodePtr n, const xmlChar *uri, const xmlChar *prefix) {
+	xmlNsPtr ns = xmlSearchNsByHref(n->doc, n, uri);
+	// declared outside the streamed element, so declare it again on it, it'll need it once it's on its own.
+	if (ns == NULL)
+		ns = xmlNewNs(parser->streamedNode, uri, prefix);
+	return ns;
+}
+
+static void pushStartElement(void *c, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI,
+							 int nb_namespaces, const xmlChar **namespaces, int nb_attributes, int nb_defaulted, const xmlChar **attributes) {
+	xmlParserCtxtPtr ctx = (xmlParserCtxtPtr)c;
+	ZKPushParser *parser = (ZKPushParser *)ctx->_private;
+	if (parser->streamedNode == NULL && (ctx->nodeNr + 1 != parser->streamedDepth || xmlStrcmp(localname, parser->streamedName))) {
+		xmlSAX2StartElementNs(c, localname, prefix, URI, nb_namespaces, namespaces, nb_attributes, nb_defaulted, attributes);
+		return;
+	}
+	xmlNodePtr n = xmlNewDocNode(ctx->myDoc, NULL, localname, NULL);
+	if (parser->streamedNode == NULL)
+		parser->streamedNode = n;
+	else
+		xmlAddChild(parser->streamedCurrent, n);
+	parser->streamedCurrent = n;
+	for (int i = 0; i < nb_namespaces; i++)
+		xmlNewNs(n, namespaces[i * 2 + 1], namespaces[i * 2]);
+	if (URI != NULL)
+		xmlSetNs(n, streamedNs(parser, n, URI, prefix));
+	// each attribute is localname/prefix/URI/value/end, the value may still have its entity & char refs in it.
+	for (int i = 0; i < nb_attributes; i++) {
+		const xmlChar **a = attributes + i * 5;
+		int len = (int)(a[4] - a[3]);
+		xmlChar *v = NULL;
+		if (memchr(a[3], '&', len) != NULL) {
+			xmlNodePtr decoded = xmlStringLenGetNodeList(ctx->myDoc, a[3], len);
+			v = xmlNodeListGetString(ctx->myDoc, decoded, 1);
+			xmlFreeNodeList(decoded);
+		} else {
+			v = xmlStrndup(a[3], len);
+		}
+		xmlNewNsProp(n, a[2] != NULL ? streamedNs(parser, n, a[2], a[1]) : NULL, a[0], v);
+		xmlFree(v);
+	}
+}
+
+static void pushCharacters(void *c, const xmlChar *ch, int len) {
+	xmlParserCtxtPtr ctx = (xmlParserCtxtPtr)c;
+	ZKPushParser *parser = (ZKPushParser *)ctx->_private;
+	if (parser->streamedNode == NULL) {
+		xmlSAX2Characters(c, ch, len);
+		return;
+	}
+	xmlNodePtr last = parser->streamedCurrent->last;
+	if (last != NULL && last->type == XML_TEXT_NODE)
+		xmlTextConcat(last, ch, len);
+	else
+		xmlAddChild(parser->streamedCurrent, xmlNewDocTextLen(ctx->myDoc, ch, len));
+}
+
+static void pushCDataBlock(void *c, const xmlChar *value, int len) {
+	xmlParserCtxtPtr ctx = (xmlParserCtxtPtr)c;
+	ZKPushParser *parser = (ZKPushParser *)ctx->_private;
+	if (parser->streamedNode == NULL)
+		xmlSAX2CDataBlock(c, value, len);
+	else
+		xmlAddChild(parser->streamedCurrent, xmlNewCDataBlock(ctx->myDoc, value, len));
+}
+
+// comments in a streamed element are dropped, the default handler would add them to the wrong node.
+static void pushComment(void *c, const xmlChar *value) {
+	xmlParserCtxtPtr ctx = (xmlParserCtxtPtr)c;
+	ZKPushParser *parser = (ZKPushParser *)ctx->_private;
+	if (parser->streamedNode == NULL)
+		xmlSAX2Comment(c, value);
+}
+
+static void pushEndElement(void *c, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI) {
+	xmlParserCtxtPtr ctx = (xmlParserCtxtPtr)c;
+	ZKPushParser *parser = (ZKPushParser *)ctx->_private;
+	if (parser->aborted) {
+		xmlStopParser(ctx);
+		return;
+	}
+	if (parser->streamedNode == NULL) {
+		xmlSAX2EndElementNs(c, localname, prefix, URI);
+		return;
+	}
+	if (parser->streamedCurrent != parser->streamedNode) {
+		parser->streamedCurrent = parser->streamedCurrent->parent;
+		return;
+	}
+	xmlNodePtr cur = parser->streamedNode;
+	parser->streamedNode = parser->streamedCurrent = NULL;
+	
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+	@try {
+		zkElement *e = [[zkElement alloc] initWithNode:cur parent:nil];
+		parser->elementBlock(e);
+		[e release];
+	} @catch (NSException *ex) {
+		// don't let the exception unwind through libxml, hang onto it for finish to throw.
+		parser->blockException = [ex retain];
+		xmlStopParser(ctx);
+	}
+	parser->elementBlockTime += CFAbsoluteTimeGetCurrent() - start;
+	[pool release];
+	xmlFreeNode(cur);
+}
+
+- (id)initWithStreamedElement:(NSString *)name depth:(int)depth block:(zkElementBlock)block {
+	self = [super init];
+	streamedName = xmlStrdup((const xmlChar *)[name UTF8String]);
+	streamedDepth = depth;
+	elementBlock = [block copy];
+	xmlSAXHandler sax;
+	memset(&sax, 0, sizeof(sax));
+	xmlSAXVersion(&sax, 2);
+	sax.startElementNs = pushStartElement;
+	sax.endElementNs = pushEndElement;
+	sax.characters = pushCharacters;
+	sax.ignorableWhitespace = pushCharacters;
+	sax.cdataBlock = pushCDataBlock;
+	sax.comment = pushComment;
+	ctx = xmlCreatePushParserCtxt(&sax, NULL, NULL, 0, "noname.xml");
+	ctx->_private = self;
+	return self;
+}
+
+- (void)dealloc {
+	// before the document, whose dictionary its names may be in.
+	xmlFreeNode(streamedNode);
+	if (ctx != NULL) {
+		xmlFreeDoc(ctx->myDoc);
+		xmlFreeParserCtxt(ctx);
+	}
+	xmlFree(streamedName);
+	[elementBlock release];
+	[blockException release];
+	[super dealloc];
+}
+
+- (void)abort {
+	aborted = YES;
+}
+
+- (void)parseChunk:(NSData *)data {
+	if (ctx == NULL || blockException != nil || aborted) return;
+	bytesParsed += [data length];
+	CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+	xmlParseChunk(ctx, [data bytes], (int)[data length], 0);
+	parseTime += CFAbsoluteTimeGetCurrent() - start;
+}
+
+- (zkElement *)finish {
+	if (ctx == NULL) return nil;
+	if (blockException == nil && !aborted) {
+		CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+		xmlParseChunk(ctx, NULL, 0, 1);
+		parseTime += CFAbsoluteTimeGetCurrent() - start;
+	}
+	xmlDocPtr doc = ctx->myDoc;
+	int wellFormed = ctx->wellFormed;
+	ctx->myDoc = NULL;
+	xmlFreeParserCtxt(ctx);
+	ctx = NULL;
+	// a streamed element the parse stopped part way through.
+	xmlFreeNode(streamedNode);
+	streamedNode = streamedCurrent = NULL;
+	if (blockException != nil) {
+		xmlFreeDoc(doc);
+		@throw [[blockException retain] autorelease];
+	}
+	if (!wellFormed || aborted || doc == NULL) {
+		xmlFreeDoc(doc);
+		return nil;
+	}
+	return [[[zkElement alloc] initWithDocument:doc] autorelease];
+}
+
+@end
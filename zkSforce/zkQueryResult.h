@@ -20,6 +20,7 @@
 //
 
 @class zkElement;
+@class ZKSObject;
 
 @interface ZKQueryResult : NSObject <NSCopying> {
 	int size;
@@ -29,11 +30,21 @@
 }
 
 - (id)initFromXmlNode:(zkElement *)node;
+// splits decoding the records across up to this many threads, the records end up
+// in the same order regardless. initFromXmlNode: decodes them all on the calling thread.
+- (id)initFromXmlNode:(zkElement *)node decodeConcurrency:(NSUInteger)threads;
+// for when the records were already decoded as the response was being parsed.
+- (id)initFromXmlNode:(zkElement *)node records:(NSArray *)records;
 - (id)initWithRecords:(NSArray *)records size:(int)s done:(BOOL)d queryLocator:(NSString *)ql;
 
+// decodes a single records element, returns nil if it's xsi:nil.
++ (ZKSObject *)recordFromXmlNode:(zkElement *)node;
+
 - (int)size;
 - (BOOL)done;
 - (NSString *)queryLocator;
 - (NSArray *)records;
+// the number of records in this batch, size is the total for the whole query.
+- (NSUInteger)count;
 
 @end
@@ -26,29 +26,68 @@
 
 @implementation ZKQueryResult
 
++ (ZKSObject *)recordFromXmlNode:(zkElement *)n {
+	NSString *xsiNil = [n attributeValue:@"nil" ns:NS_URI_XSI];
+	if (xsiNil != nil && [xsiNil isEqualToString:@"true"]) 
+		return nil;
+	return [[[ZKSObject alloc] initFromXmlNode:n] autorelease];
+}
+
+// below this many records per thread, it's not worth the overhead of splitting them up.
+static const NSUInteger MIN_RECORDS_PER_THREAD = 50;
+
+// Decodes the records in contiguous chunks, one per thread, each into its own
+// slots of a shared array, so the order doesn't depend on which chunk finishes
+// first. The DOM is only read while this is going on, which is safe to do from
+// several threads at once.
++ (NSArray *)recordsFromXmlNodes:(NSArray *)nodes concurrency:(NSUInteger)threads {
+	NSUInteger count = [nodes count];
+	NSUInteger chunks = MIN(threads, count / MIN_RECORDS_PER_THREAD);
+	if (chunks <= 1) {
+		NSMutableArray * recArray = [NSMutableArray arrayWithCapacity:count];
+		for (zkElement *n in nodes) {
+			ZKSObject *o = [ZKQueryResult recordFromXmlNode:n];
+			if (o != nil)
+				[recArray addObject:o];
+		}
+		return recArray;
+	}
+	ZKSObject **decoded = calloc(count, sizeof(ZKSObject *));
+	NSUInteger chunkSize = (count + chunks - 1) / chunks;
+	dispatch_apply(chunks, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t chunk) {
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+		NSUInteger end = MIN(count, (chunk + 1) * chunkSize);
+		for (NSUInteger i = chunk * chunkSize; i < end; i++)
+			decoded[i] = [[ZKQueryResult recordFromXmlNode:[nodes objectAtIndex:i]] retain];
+		[pool release];
+	});
+	NSMutableArray * recArray = [NSMutableArray arrayWithCapacity:count];
+	for (NSUInteger i = 0; i < count; i++) {
+		if (decoded[i] == nil) continue;
+		[recArray addObject:decoded[i]];
+		[decoded[i] release];
+	}
+	free(decoded);
+	return recArray;
+}
+
 - (id)initFromXmlNode:(zkElement *)node {
+	return [self initFromXmlNode:node decodeConcurrency:1];
+}
+
+- (id)initFromXmlNode:(zkElement *)node decodeConcurrency:(NSUInteger)threads {
+	NSArray *recArray = [ZKQueryResult recordsFromXmlNodes:[node childElements:@"records"] concurrency:threads];
+	return [self initFromXmlNode:node records:recArray];
+}
+
+- (id)initFromXmlNode:(zkElement *)node records:(NSArray *)r {
 	self = [super init];
-	int i = 0;
 	size = [[[node childElement:@"size"] stringValue] intValue];
 	NSString * strDone = [[node childElement:@"done"] stringValue]; 
 	done = [strDone isEqualToString:@"true"];
 	if (done == NO)
 		queryLocator = [[[node childElement:@"queryLocator"] stringValue] copy];
-		
-	NSArray * nodes = [node childElements:@"records"];
-	NSMutableArray * recArray = [NSMutableArray arrayWithCapacity:[nodes count]];
-	ZKSObject * o;
-	for (i = 0; i < [nodes count]; i++)
-	{
-		zkElement * n = [nodes objectAtIndex:i];
-		NSString *xsiNil = [n attributeValue:@"nil" ns:NS_URI_XSI];
-		if (xsiNil != nil && [xsiNil isEqualToString:@"true"]) 
-			continue;
-		o = [[ZKSObject alloc] initFromXmlNode:n];
-		[recArray addObject:o];
-		[o release];
-	}	
-	records = [recArray retain];
+	records = [r retain];
 	return self;
 }
 
@@ -87,4 +126,8 @@
 	return records;
 }
 
+- (NSUInteger)count {
+	return [records count];
+}
+
 @end
@@ -50,6 +50,8 @@ NSString * NS_URI_XSI;
 - (void)setFieldDateTimeValue:(NSDate *)value field:(NSString *)field;
 - (void)setFieldDateValue:(NSDate *)value field:(NSString *)field;
 - (void)setFieldToNull:(NSString *)field;
+// copies every field (and fieldsToNull) from another sObject, for a record that was read in pieces.
+- (void)addFieldsFromSObject:(ZKSObject *)other;
 
 // basic getters
 - (NSString *)id;
@@ -23,20 +23,12 @@
 #import "zkSObject.h"
 #import "zkQueryResult.h"
 #import "zkParser.h"
+#import "ZKDateTime.h"
 
 NSString * NS_URI_XSI = @"http://www.w3.org/2001/XMLSchema-instance";
 
-static NSDateFormatter *dateFormatter, *dateTimeFormatter;
-
 @implementation ZKSObject
 
-+(void)initialize {
-	dateTimeFormatter = [[NSDateFormatter alloc] init];
-	[dateTimeFormatter setDateFormat:@"yyyy-MM-dd'T'HH:mm:ss.SSSSZ"];
-	dateFormatter = [[NSDateFormatter alloc] init];
-	[dateFormatter setDateFormat:@"yyyy-MM-dd"];
-}
-
 + (id)withType:(NSString *)type {
 	return [[[ZKSObject alloc] initWithType:type] autorelease];
 }
@@ -62,18 +54,15 @@ static NSDateFormatter *dateFormatter, *dateTimeFormatter;
 
 - (id) initFromXmlNode:(zkElement *)node {
 	self = [super init];
-	NSUInteger i, childCount;
 	Id = [[[node childElement:@"Id"] stringValue] copy];
 	type = [[[node childElement:@"type"] stringValue] copy];
 	fields = [[NSMutableDictionary alloc] init];
 	fieldOrder = [[NSMutableArray alloc] init];
 	fieldsToNull = [[NSMutableSet alloc] init];
-	NSArray *children = [node childElements];
-	childCount = [children count];
-	// start at 2 to skip Id & Type
-	for (i = 2; i < childCount; i++)
-	{
-		zkElement *f = [children objectAtIndex:i];
+	__block NSUInteger i = 0;
+	[node enumerateChildElementsUsingBlock:^(zkElement *f, BOOL *stop) {
+		// skip Id & Type
+		if (i++ < 2) return;
 		NSString *xsiNil = [f attributeValue:@"nil" ns:NS_URI_XSI];
 		id fieldVal;
 		if (xsiNil != nil && [xsiNil isEqualToString:@"true"]) 
@@ -87,9 +76,10 @@ static NSDateFormatter *dateFormatter, *dateTimeFormatter;
 			else
 				fieldVal = [f stringValue];
 		}
-		[fields setValue:fieldVal forKey:[f name]];
-		[fieldOrder addObject:[f name]];
-	}
+		NSString *name = [f name];
+		[fields setValue:fieldVal forKey:name];
+		[fieldOrder addObject:name];
+	}];
 	return self;
 }
 
@@ -151,16 +141,29 @@ static NSDateFormatter *dateFormatter, *dateTimeFormatter;
 	}
 }
 
+- (void)addFieldsFromSObject:(ZKSObject *)other {
+	if (Id == nil)
+		Id = [[other id] copy];
+	// copied as is, rather than via setFieldValue, so that nil fields from a query stay as NSNull in fields.
+	for (NSString *field in [other orderedFieldNames]) {
+		[fields setObject:[[other fields] objectForKey:field] forKey:field];
+		if (![fieldOrder containsObject:field])
+			[fieldOrder addObject:field];
+	}
+	for (NSString *field in [other fieldsToNull]) {
+		[fieldsToNull addObject:field];
+		[fields removeObjectForKey:field];
+		[fieldOrder removeObject:field];
+	}
+}
+
 - (void)setFieldDateTimeValue:(NSDate *)value field:(NSString *)field {
-	NSMutableString *dt = [NSMutableString stringWithString:[dateTimeFormatter stringFromDate:value]];
-	// meh, insert the : in the TZ offset, to make it xsd:dateTime
-	[dt insertString:@":" atIndex:[dt length]-2];
-	[self setFieldValue:dt field:field];
+	[self setFieldValue:[ZKDateTime dateTimeStringFromDate:value] field:field];
 }
 
 - (void)setFieldDateValue:(NSDate *)value field:(NSString *)field {
-	[self setFieldValue:[dateFormatter stringFromDate:value] field:field];	
-}	
+	[self setFieldValue:[ZKDateTime dateStringFromDate:value] field:field];
+}
 
 - (id)fieldValue:(NSString *)field {
 	id v = [fields objectForKey:field];
@@ -176,16 +179,11 @@ static NSDateFormatter *dateFormatter, *dateTimeFormatter;
 }
 
 - (NSDate *)dateTimeValue:(NSString *)field {
-	// ok, so a little hackish, but does the job
-	// note to self, make sure API always returns GMT times ;)
-	NSMutableString *dt = [NSMutableString stringWithString:[self fieldValue:field]];
-	[dt deleteCharactersInRange:NSMakeRange([dt length] -1,1)];
-	[dt appendString:@"+00"];
-	return [dateTimeFormatter dateFromString:dt];
+	return [ZKDateTime dateFromDateTimeString:[self fieldValue:field]];
 }
 
 - (NSDate *)dateValue:(NSString *)field {
-	return [dateFormatter dateFromString:[self fieldValue:field]];
+	return [ZKDateTime dateFromDateString:[self fieldValue:field]];
 }
 
 - (int)intValue:(NSString *)field {
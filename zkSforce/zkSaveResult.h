@@ -23,8 +23,12 @@
 #import "zkXmlDeserializer.h"
 
 @interface ZKSaveResult : ZKXmlDeserializer {
+	NSString *failedCode, *failedMessage;	// set when the record's batch never made it to the server.
 }
 
+// a result for a record that wasn't saved because the call for its batch failed.
++ (id)failedResultWithException:(NSException *)ex;
+
 - (NSString *)id;
 - (BOOL)success;
 - (NSString *)statusCode;
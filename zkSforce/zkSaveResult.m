@@ -22,24 +22,42 @@
 
 #import "zkSaveResult.h"
 #import "zkParser.h"
+#import "zkSoapException.h"
 
 @implementation ZKSaveResult
 
++ (id)failedResultWithException:(NSException *)ex {
+	ZKSaveResult *r = [[[ZKSaveResult alloc] initWithXmlElement:nil] autorelease];
+	NSString *code = [ex isKindOfClass:[ZKSoapException class]] ? [(ZKSoapException *)ex faultCode] : nil;
+	r->failedCode = [(code != nil ? code : [ex name]) copy];
+	r->failedMessage = [[ex reason] copy];
+	return r;
+}
+
+- (void)dealloc {
+	[failedCode release];
+	[failedMessage release];
+	[super dealloc];
+}
+
 - (NSString *)id {
 	return [self string:@"id"];
 }
 
 - (BOOL)success {
+	if (failedCode != nil) return NO;
 	return [self boolean:@"success"];
 }
 
 - (NSString *)statusCode {
 	if ([self success]) return nil;
+	if (failedCode != nil) return failedCode;
 	return [self string:@"statusCode" fromXmlElement:[node childElement:@"errors"]];
 }
 
 - (NSString *)message {
 	if ([self success]) return nil;
+	if (failedCode != nil) return failedMessage;
 	return [self string:@"message" fromXmlElement:[node childElement:@"errors"]];
 }
 
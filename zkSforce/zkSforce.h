@@ -44,4 +44,10 @@
 #import "ZKRelatedList.h"
 #import "ZKRelatedListColumn.h"
 #import "ZKRelatedListSort.h"
-#import "zkChildRelationship.h"
\ No newline at end of file
+#import "zkChildRelationship.h"
+#import "ZKCancellationToken.h"
+#import "ZKOperationStats.h"
+#import "ZKQueryMoreEnumerator.h"
+#import "ZKRecordBatch.h"
+#import "ZKDateTime.h"
+#import "ZKMetadataCache.h"
\ No newline at end of file
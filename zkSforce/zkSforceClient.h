@@ -28,6 +28,16 @@
 @class ZKQueryResult;
 @class ZKLoginResult;
 @class ZKDescribeLayoutResult;
+@class ZKCancellationToken;
+@class ZKRecordBatch;
+@class ZKMetadataCache;
+
+typedef void (^zkCompleteQueryResultBlock)(ZKQueryResult *result);
+typedef void (^zkCompleteRecordBatchBlock)(ZKRecordBatch *result);
+typedef void (^zkCompleteArrayBlock)(NSArray *result);
+typedef void (^zkCompleteDictionaryBlock)(NSDictionary *result);
+typedef void (^zkCompleteDescribeSObjectBlock)(ZKDescribeSObject *result);
+typedef void (^zkCompleteDescribeLayoutResultBlock)(ZKDescribeLayoutResult *result);
 
 // This is the primary entry point into the library, you'd create one of these
 // call login, then use it to make other API calls. Your session is automatically
@@ -39,7 +49,16 @@
 	BOOL		updateMru;
 	ZKUserInfo	*userInfo;
 	BOOL		cacheDescribes;
+	BOOL		detachDescribes;
+	int			queryBatchSize;
+	BOOL		adaptiveQueryBatchSize;
+	int			adaptiveBatchSize;
+	int			saveBatchSize;
+	int			saveConcurrency;
+	int			retrieveConcurrency;
+	int			decodeConcurrency;
 	NSMutableDictionary	*describes;
+	ZKMetadataCache		*metadataCache;
 	int			preferedApiVersion;
     
     NSObject<ZKAuthenticationInfo>  *authSource;
@@ -102,6 +121,12 @@
 // cached copy.
 - (ZKDescribeSObject *)describeSObject:(NSString *)sobjectName;
 
+// makes as few describeSObjects calls as it takes to describe all the named sobjects (the
+// API takes up to 100 at a time, but they're sent in smaller batches in parallel), and
+// returns a ZKDescribeSObject for each, in the same order. if describe caching is enabled
+// only the sobjects that aren't already cached are asked for.
+- (NSArray *)describeSObjects:(NSArray *)sobjectNames;
+
 // makes a describeLayout call and returns a ZKDescribeLayoutResult isntance.
 // these are NOT cached, regardless of the describe caching flag.
 - (ZKDescribeLayoutResult *)describeLayout:(NSString *)sobjectName recordTypeIds:(NSArray *)recordTypeIds;
@@ -120,8 +145,8 @@
 - (ZKQueryResult *)queryMore:(NSString *)queryLocator;
 
 // retreives a set of records, fields is a comma separated list of fields to fetch values for
-// ids can be upto 200 record Ids, the returned dictionary is keyed from Id and the dictionary
-// values are ZKSObject's.
+// the returned dictionary is keyed from Id and the dictionary values are ZKSObject's. The API
+// takes upto 200 record Ids per call, any more than that are split up and fetched in parallel.
 - (NSDictionary *)retrieve:(NSString *)fields sobject:(NSString *)sobjectType ids:(NSArray *)ids;
 
 // pass an array of ZKSObject's to create in salesforce, returns a matching array of ZKSaveResults
@@ -140,6 +165,36 @@
 - (void)setPassword:(NSString *)newPassword forUserId:(NSString *)userId;
 
 
+// Async versions of the above calls. These return immediately, and don't tie up a
+// thread while the request is in flight, so many calls can be outstanding at once.
+// Once the call is done, either failBlock or completeBlock is called on the main
+// thread. failBlock gets passed the exception the blocking version would have thrown.
+// Cancelling the returned token stops the call, and neither block is called.
+//////////////////////////////////////////////////////////////////////////////////////
+- (ZKCancellationToken *)performDescribeGlobalWithFailBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock;
+- (ZKCancellationToken *)performDescribeSObject:(NSString *)sobjectName failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteDescribeSObjectBlock)completeBlock;
+- (ZKCancellationToken *)performDescribeSObjects:(NSArray *)sobjectNames failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock;
+- (ZKCancellationToken *)performDescribeLayout:(NSString *)sobjectName recordTypeIds:(NSArray *)recordTypeIds failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteDescribeLayoutResultBlock)completeBlock;
+- (ZKCancellationToken *)performSearch:(NSString *)sosl failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock;
+- (ZKCancellationToken *)performQuery:(NSString *)soql failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteQueryResultBlock)completeBlock;
+- (ZKCancellationToken *)performQueryAll:(NSString *)soql failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteQueryResultBlock)completeBlock;
+- (ZKCancellationToken *)performQueryMore:(NSString *)queryLocator failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteQueryResultBlock)completeBlock;
+// runs all the queries at once, the results are an array of ZKQueryResult in the same order as the queries.
+// if any query fails, the rest are cancelled and failBlock is called with the first error.
+- (ZKCancellationToken *)performQueries:(NSArray *)soqls failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock;
+// as above, but the blocks are called on the given queue rather than the main thread, and
+// the call is tied to the passed in token, so one token can cancel a whole chain of calls.
+- (ZKCancellationToken *)performQueryMore:(NSString *)queryLocator token:(ZKCancellationToken *)token queue:(dispatch_queue_t)queue failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteQueryResultBlock)completeBlock;
+// as performQuery/performQueryMore, but the records are stored by column in a ZKRecordBatch rather
+// than as a ZKSObject each, which is much smaller for big batches, see ZKRecordBatch.h
+- (ZKCancellationToken *)performRecordBatchQuery:(NSString *)soql failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteRecordBatchBlock)completeBlock;
+- (ZKCancellationToken *)performRecordBatchQueryMore:(NSString *)queryLocator token:(ZKCancellationToken *)token queue:(dispatch_queue_t)queue failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteRecordBatchBlock)completeBlock;
+- (ZKCancellationToken *)performRetrieve:(NSString *)fields sobject:(NSString *)sobjectType ids:(NSArray *)ids failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteDictionaryBlock)completeBlock;
+- (ZKCancellationToken *)performCreate:(NSArray *)objects failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock;
+- (ZKCancellationToken *)performUpdate:(NSArray *)objects failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock;
+- (ZKCancellationToken *)performDelete:(NSArray *)ids failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock;
+
+
 // Information about the current session
 //////////////////////////////////////////////////////////////////////////////////////
 // returns true if we've performed a login request and it succeeded.
@@ -166,10 +221,58 @@
 // If you have a clientIf for a certifed partner application, you can set it here.
 @property (retain) NSString *clientId;
 
+// How many rows query/queryMore calls should return at a time, the API accepts
+// 200 to 2000, and the server may return fewer if the rows are large. 0 (the
+// default) leaves it up to the server.
+@property (assign) int queryBatchSize;
+
+// Tune the batch size as queries run, bigger batches while they're coming back
+// quickly, smaller ones if they get slow or large. queryBatchSize is used as
+// the starting point if it's set. (defaults false)
+@property (assign) BOOL adaptiveQueryBatchSize;
+
+// How many records each create/update/delete call sends at a time, the API
+// accepts up to 200. Calls with more than this are split up. (defaults 25)
+@property (assign) int saveBatchSize;
+
+// How many of those batches can be in flight at once, the results are still
+// returned in the same order as the records. If a batch fails, its records
+// get failed ZKSaveResults, the call only fails if every batch did. (defaults 1)
+@property (assign) int saveConcurrency;
+
+// How many of the calls a large retrieve or describeSObjects is split into can be in flight at once. (defaults 4)
+@property (assign) int retrieveConcurrency;
+
+// How many threads the records of a query/queryMore response can be decoded
+// across, they come back in the same order regardless. Above 1 the whole
+// response is read before any records are decoded, rather than decoding each
+// one as it arrives, so this trades peak memory for decode time on large
+// batches of wide rows. (defaults 1)
+@property (assign) int decodeConcurrency;
+
 
 // describe caching
 //////////////////////////////////////////////////////////////////////////////////////
 @property (assign) BOOL cacheDescribes;
 - (void)flushCachedDescribes;
 
+// describe and describeLayout results are fully decoded when they arrive, and
+// don't hold onto the response XML, so caching them only costs what they
+// actually contain. (defaults true)
+@property (assign) BOOL detachDescribes;
+
+// If set, the XML of every describeGlobal, describeSObject and describeLayout
+// (with no recordTypeIds) response is written to this cache as it arrives, and
+// the cachedDescribe methods below can decode them again later, without going
+// to the network, e.g. to show something straight away at startup while the
+// real describes are made in the background. (defaults nil)
+@property (retain) ZKMetadataCache *metadataCache;
+
+// these return what's in the metadataCache, or nil if there's nothing there,
+// they never make an API call, and don't use or populate the in memory
+// describe cache.
+- (NSArray *)cachedDescribeGlobal;
+- (ZKDescribeSObject *)cachedDescribeSObject:(NSString *)sobjectName;
+- (ZKDescribeLayoutResult *)cachedDescribeLayout:(NSString *)sobjectName;
+
 @end
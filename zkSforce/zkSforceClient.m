@@ -32,19 +32,85 @@
 #import "zkDescribeGlobalSObject.h"
 #import "zkParser.h"
 #import "ZKDescribeLayoutResult.h"
+#import "ZKMetadataCache.h"
+#import "ZKOperationStats.h"
+#import "ZKCancellationToken.h"
+#import "ZKRecordBatch.h"
+#import "ZKBatchedCall.h"
 
-static const int SAVE_BATCH_SIZE = 25;
+static const int DEFAULT_SAVE_BATCH_SIZE = 25;
+static const int MAX_SAVE_BATCH_SIZE = 200;
+static const int RETRIEVE_BATCH_SIZE = 200;
+static const int DEFAULT_RETRIEVE_CONCURRENCY = 4;
+// describeSObjects takes up to 100 at once, but a describe can be a few hundred KB, so
+// we ask for a few at a time, and parse them in parallel.
+static const int DESCRIBE_SOBJECTS_BATCH_SIZE = 5;
+
+// the range of query batch sizes the API accepts, adaptive sizing starts in the
+// middle, and aims for each batch to take about QUERY_BATCH_TARGET_TIME, and be no bigger than QUERY_BATCH_MAX_BYTES.
+static const int MIN_QUERY_BATCH_SIZE = 200;
+static const int MAX_QUERY_BATCH_SIZE = 2000;
+static const int DEFAULT_ADAPTIVE_BATCH_SIZE = 500;
+static const NSTimeInterval QUERY_BATCH_TARGET_TIME = 2.0;
+static const NSUInteger QUERY_BATCH_MAX_BYTES = 4 * 1024 * 1024;
 
 @interface ZKSforceClient (Private)
 - (ZKQueryResult *)queryImpl:(NSString *)value operation:(NSString *)op name:(NSString *)elemName;
 - (NSArray *)sobjectsImpl:(NSArray *)objects name:(NSString *)elemName;
 - (void)checkSession;
 @property (retain, getter=currentUserInfo) ZKUserInfo *userInfo;
+
+// these build the request envelope, and decode the response for a call, they're
+// shared by the blocking and the async versions of each call.
+- (NSData *)describeGlobalEnvelope;
+- (NSArray *)describeGlobalFromResponse:(zkElement *)rr;
+- (NSData *)describeSObjectEnvelope:(NSString *)sobjectName;
+- (ZKDescribeSObject *)describeSObjectFromResponse:(zkElement *)dr name:(NSString *)sobjectName;
+- (NSData *)describeSObjectsEnvelope:(NSArray *)sobjectNames;
+- (NSArray *)describeSObjectsFromResponse:(zkElement *)dr names:(NSArray *)sobjectNames;
+- (ZKCancellationToken *)performDescribeSObjects:(NSArray *)sobjectNames queue:(dispatch_queue_t)queue failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock;
+- (NSData *)describeLayoutEnvelope:(NSString *)sobjectName recordTypeIds:(NSArray *)recordTypeIds;
+- (ZKDescribeLayoutResult *)describeLayoutFromResponse:(zkElement *)dr;
+- (void)storeResponse:(zkElement *)response forKey:(NSString *)key;
+- (void)observeAuthSource;
+- (void)sessionRefreshedInBackground:(NSNotification *)n;
+- (NSData *)searchEnvelope:(NSString *)sosl;
+- (NSArray *)searchResultsFromResponse:(zkElement *)sr;
+- (NSData *)queryEnvelope:(NSString *)value operation:(NSString *)operation name:(NSString *)elemName batchSize:(int)batchSize;
+- (int)nextQueryBatchSize;
+- (void)recordQueryBatch:(ZKQueryResult *)qr batchSize:(int)batchSize bytes:(NSUInteger)bytes duration:(NSTimeInterval)duration;
+- (ZKQueryResult *)queryResultFromResponse:(zkElement *)qr;
+- (NSData *)sobjectsEnvelope:(NSArray *)objects name:(NSString *)elemName;
+- (NSData *)deleteEnvelope:(NSArray *)ids;
+- (NSArray *)saveResultsFromResponse:(zkElement *)cr;
+- (id)cachedDescribeForKey:(NSString *)key;
+- (void)cacheDescribe:(id)desc forKey:(NSString *)key;
+
+- (ZKCancellationToken *)performRequest:(NSData *(^)(void))envelopeBlock decoder:(id (^)(zkElement *response))decoder failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(void (^)(id result))completeBlock;
+- (ZKCancellationToken *)performRequest:(NSData *(^)(void))envelopeBlock parser:(ZKPushParser *)parser token:(ZKCancellationToken *)token queue:(dispatch_queue_t)queue decoder:(id (^)(zkElement *response, NSUInteger length))decoder failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(void (^)(id result))completeBlock;
+- (NSArray *)saveImpl:(NSArray *)items envelope:(NSData *(^)(NSArray *batch))envelopeBlock;
+- (NSData *)retrieveEnvelope:(NSString *)fields sobject:(NSString *)sobjectType ids:(NSArray *)ids;
+- (NSArray *)retrieveResultsFromResponse:(zkElement *)rr;
+- (ZKCancellationToken *)performRetrieve:(NSString *)fields sobject:(NSString *)sobjectType ids:(NSArray *)ids queue:(dispatch_queue_t)queue failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteDictionaryBlock)completeBlock;
+- (ZKCancellationToken *)performSave:(NSArray *)items envelope:(NSData *(^)(NSArray *batch))envelopeBlock queue:(dispatch_queue_t)queue failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock;
 @end
 
+// the metadataCache keys for each describe.
+static NSString *describeGlobalCacheKey(void) {
+	return @"describeGlobal";
+}
+
+static NSString *describeSObjectCacheKey(NSString *sobjectName) {
+	return [@"describeSObject:" stringByAppendingString:[sobjectName lowercaseString]];
+}
+
+static NSString *describeLayoutCacheKey(NSString *sobjectName) {
+	return [@"describeLayout:" stringByAppendingString:[sobjectName lowercaseString]];
+}
+
 @implementation ZKSforceClient
 
-@synthesize preferedApiVersion, updateMru, clientId, cacheDescribes;
+@synthesize preferedApiVersion, updateMru, clientId, cacheDescribes, detachDescribes, metadataCache;
 
 - (id)init {
 	self = [super init];
@@ -52,14 +118,21 @@ static const int SAVE_BATCH_SIZE = 25;
 	[self setLoginProtocolAndHost:@"https://www.salesforce.com"];
 	updateMru = NO;
 	cacheDescribes = NO;
+	saveBatchSize = DEFAULT_SAVE_BATCH_SIZE;
+	saveConcurrency = 1;
+	retrieveConcurrency = DEFAULT_RETRIEVE_CONCURRENCY;
+	decodeConcurrency = 1;
+	detachDescribes = YES;
 	return self;
 }
 
 - (void)dealloc {
+	[[NSNotificationCenter defaultCenter] removeObserver:self name:ZKSessionRefreshedInBackgroundNotification object:nil];
 	[authEndpointUrl release];
 	[clientId release];
 	[userInfo release];
 	[describes release];
+	[metadataCache release];
     [authSource release];
 	[super dealloc];
 }
@@ -73,8 +146,19 @@ static const int SAVE_BATCH_SIZE = 25;
 	rhs->userInfo = [userInfo retain];
 	rhs->preferedApiVersion = preferedApiVersion;
     rhs->authSource = [authSource retain];
+	[rhs observeAuthSource];
 	[rhs setCacheDescribes:cacheDescribes];
+	[rhs setDetachDescribes:detachDescribes];
+	[rhs setMetadataCache:metadataCache];
+	[rhs setQueryBatchSize:queryBatchSize];
+	[rhs setAdaptiveQueryBatchSize:adaptiveQueryBatchSize];
+	[rhs setSaveBatchSize:saveBatchSize];
+	[rhs setSaveConcurrency:saveConcurrency];
+	[rhs setRetrieveConcurrency:retrieveConcurrency];
+	[rhs setDecodeConcurrency:decodeConcurrency];
 	[rhs setUpdateMru:updateMru];
+	[rhs setCompressRequests:compressRequests];
+	[rhs setCompressResponses:compressResponses];
 	return rhs;
 }
 
@@ -83,17 +167,47 @@ static const int SAVE_BATCH_SIZE = 25;
 }
 
 -(void)setAuthenticationInfo:(NSObject<ZKAuthenticationInfo> *)authenticationInfo {
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:ZKSessionRefreshedInBackgroundNotification object:authSource];
     [authSource autorelease];
     authSource = [authenticationInfo retain];
     self.endpointUrl = [authSource instanceUrl];
     self.userInfo = nil;
+    [self observeAuthSource];
+}
+
+// a background refresh doesn't go through checkSession, so this is how we find out the instance may have moved.
+-(void)observeAuthSource {
+    if (authSource != nil)
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(sessionRefreshedInBackground:) name:ZKSessionRefreshedInBackgroundNotification object:authSource];
+}
+
+-(void)sessionRefreshedInBackground:(NSNotification *)n {
+    self.endpointUrl = [[n object] instanceUrl];
 }
 
 - (void)flushCachedDescribes {
-	[describes release];
-	describes = nil;
-	if (cacheDescribes)
-		describes = [[NSMutableDictionary alloc] init];
+	@synchronized (self) {
+		[describes release];
+		describes = nil;
+		if (cacheDescribes)
+			describes = [[NSMutableDictionary alloc] init];
+	}
+}
+
+// describes are cached from whichever queue decoded them, and looked up from any thread, so all
+// access to the dictionary goes through these two.
+- (id)cachedDescribeForKey:(NSString *)key {
+	if (!cacheDescribes) return nil;
+	@synchronized (self) {
+		return [[[describes objectForKey:key] retain] autorelease];
+	}
+}
+
+- (void)cacheDescribe:(id)desc forKey:(NSString *)key {
+	if (!cacheDescribes) return;
+	@synchronized (self) {
+		[describes setObject:desc forKey:key];
+	}
 }
 
 - (void)setLoginProtocolAndHost:(NSString *)protocolAndHost {
@@ -168,33 +282,37 @@ static const int SAVE_BATCH_SIZE = 25;
 	[env endElement:@"setPassword"];
 	[env endElement:@"s:Body"];
 	
-	[self sendRequest:[env end]];
+	[self sendRequestData:[env endData] returnRoot:NO];
 }
 
 - (NSArray *)describeGlobal {
 	if(!authSource) return NULL;
 	[self checkSession];
-	if (cacheDescribes) {
-		NSArray *dg = [describes objectForKey:@"describe__global"];	// won't be an sfdc object ever called this.
-		if (dg != nil) return dg;
-	}
-	
-	ZKEnvelope * env = [[ZKPartnerEnvelope alloc] initWithSessionHeader:[authSource sessionId] clientId:clientId];
+	NSArray *dg = [self cachedDescribeForKey:@"describe__global"];	// won't be an sfdc object ever called this.
+	if (dg != nil) return dg;
+	zkElement *rr = [self sendRequestData:[self describeGlobalEnvelope] returnRoot:NO];
+	[self storeResponse:rr forKey:describeGlobalCacheKey()];
+	return [self describeGlobalFromResponse:rr];
+}
+
+- (NSData *)describeGlobalEnvelope {
+	ZKEnvelope * env = [[[ZKPartnerEnvelope alloc] initWithSessionHeader:[authSource sessionId] clientId:clientId] autorelease];
 	[env startElement:@"describeGlobal"];
 	[env endElement:@"describeGlobal"];
 	[env endElement:@"s:Body"];
-	
-    zkElement * rr = [self sendRequest:[env end]];
+	return [env endData];
+}
+
+- (NSArray *)describeGlobalFromResponse:(zkElement *)rr {
 	NSArray *results = [[rr childElement:@"result"] childElements:@"sobjects"];
 	NSMutableArray *types = [NSMutableArray arrayWithCapacity:[results count]];
     for (zkElement *res in results) {
 		ZKDescribeGlobalSObject * d = [[ZKDescribeGlobalSObject alloc] initWithXmlElement:res];
+		if (detachDescribes) [d detach];
 		[types addObject:d];
 		[d release];
 	}
-	[env release];
-	if (cacheDescribes)
-		[describes setObject:types forKey:@"describe__global"];
+	[self cacheDescribe:types forKey:@"describe__global"];
 	return types;
 }
 
@@ -208,7 +326,7 @@ static const int SAVE_BATCH_SIZE = 25;
 	[env endElement:@"getUserInfo"];
 	[env endElement:@"s:Body"];
     
-    zkElement *dr = [self sendRequest:[env end]];
+    zkElement *dr = [self sendRequestData:[env endData] returnRoot:NO];
 	zkElement *descResult = [dr childElement:@"result"];
 	ZKUserInfo *desc = [[[ZKUserInfo alloc] initWithXmlElement:descResult] autorelease];
     [env release];
@@ -218,59 +336,160 @@ static const int SAVE_BATCH_SIZE = 25;
 
 - (ZKDescribeSObject *)describeSObject:(NSString *)sobjectName {
 	if (!authSource) return NULL;
-	if (cacheDescribes) {
-		ZKDescribeSObject * desc = [describes objectForKey:[sobjectName lowercaseString]];
-		if (desc != nil) return desc;
-	}
+	ZKDescribeSObject * desc = [self cachedDescribeForKey:[sobjectName lowercaseString]];
+	if (desc != nil) return desc;
 	[self checkSession];
-	
-	ZKEnvelope * env = [[ZKPartnerEnvelope alloc] initWithSessionHeader:[authSource sessionId] clientId:clientId];
+	zkElement *dr = [self sendRequestData:[self describeSObjectEnvelope:sobjectName] returnRoot:NO];
+	[self storeResponse:[dr childElement:@"result"] forKey:describeSObjectCacheKey(sobjectName)];
+	return [self describeSObjectFromResponse:dr name:sobjectName];
+}
+
+- (NSData *)describeSObjectEnvelope:(NSString *)sobjectName {
+	ZKEnvelope * env = [[[ZKPartnerEnvelope alloc] initWithSessionHeader:[authSource sessionId] clientId:clientId] autorelease];
 	[env startElement:@"describeSObject"];
 	[env addElement:@"SobjectType" elemValue:sobjectName];
 	[env endElement:@"describeSObject"];
 	[env endElement:@"s:Body"];
-	
-	zkElement *dr = [self sendRequest:[env end]];
+	return [env endData];
+}
+
+- (ZKDescribeSObject *)describeSObjectFromResponse:(zkElement *)dr name:(NSString *)sobjectName {
 	zkElement *descResult = [dr childElement:@"result"];
 	ZKDescribeSObject *desc = [[[ZKDescribeSObject alloc] initWithXmlElement:descResult] autorelease];
-	[env release];
-	if (cacheDescribes) 
-		[describes setObject:desc forKey:[sobjectName lowercaseString]];
+	if (detachDescribes) [desc detach];
+	[self cacheDescribe:desc forKey:[sobjectName lowercaseString]];
 	return desc;
 }
 
+- (NSArray *)describeSObjects:(NSArray *)sobjectNames {
+	if (!authSource) return nil;
+	[self checkSession];
+
+	__block NSArray *results = nil;
+	__block NSException *error = nil;
+	dispatch_semaphore_t done = dispatch_semaphore_create(0);
+	[self performDescribeSObjects:sobjectNames queue:dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0) failBlock:^(NSException *ex) {
+		error = [ex retain];
+		dispatch_semaphore_signal(done);
+	} completeBlock:^(NSArray *r) {
+		results = [r retain];
+		dispatch_semaphore_signal(done);
+	}];
+	dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+	dispatch_release(done);
+	if (error != nil)
+		@throw [error autorelease];
+	return [results autorelease];
+}
+
+- (NSData *)describeSObjectsEnvelope:(NSArray *)sobjectNames {
+	ZKEnvelope * env = [[[ZKPartnerEnvelope alloc] initWithSessionHeader:[authSource sessionId] clientId:clientId] autorelease];
+	[env startElement:@"describeSObjects"];
+	[env addElementArray:@"sObjectType" elemValue:sobjectNames];
+	[env endElement:@"describeSObjects"];
+	[env endElement:@"s:Body"];
+	return [env endData];
+}
+
+// there's a result for each name, in the order they were asked for.
+- (NSArray *)describeSObjectsFromResponse:(zkElement *)dr names:(NSArray *)sobjectNames {
+	NSArray *results = [dr childElements:@"result"];
+	NSMutableArray *descs = [NSMutableArray arrayWithCapacity:[results count]];
+	NSUInteger i = 0;
+	for (zkElement *descResult in results) {
+		NSString *name = i < [sobjectNames count] ? [sobjectNames objectAtIndex:i] : nil;
+		ZKDescribeSObject *desc = [[ZKDescribeSObject alloc] initWithXmlElement:descResult];
+		if (name == nil) name = [desc name];
+		[self storeResponse:descResult forKey:describeSObjectCacheKey(name)];
+		if (detachDescribes) [desc detach];
+		[descs addObject:desc];
+		[desc release];
+		i++;
+	}
+	return descs;
+}
+
 - (ZKDescribeLayoutResult *)describeLayout:(NSString *)sobjectName recordTypeIds:(NSArray *)recordTypeIds {
 	if (!authSource) return nil;
 	[self checkSession];
+	zkElement *dr = [self sendRequestData:[self describeLayoutEnvelope:sobjectName recordTypeIds:recordTypeIds] returnRoot:NO];
+	if ([recordTypeIds count] == 0)
+		[self storeResponse:dr forKey:describeLayoutCacheKey(sobjectName)];
+	return [self describeLayoutFromResponse:dr];
+}
+
+- (NSData *)describeLayoutEnvelope:(NSString *)sobjectName recordTypeIds:(NSArray *)recordTypeIds {
 	ZKEnvelope *env = [[[ZKPartnerEnvelope alloc] initWithSessionHeader:[authSource sessionId] clientId:clientId] autorelease];
 	[env startElement:@"describeLayout"];
 	[env addElement:@"sObjectType" elemValue:sobjectName];
 	[env addElementArray:@"recordTypeIds" elemValue:recordTypeIds];
 	[env endElement:@"describeLayout"];
 	[env endElement:@"s:Body"];
+	return [env endData];
+}
 
-	zkElement *dr = [self sendRequest:[env end]];
+- (ZKDescribeLayoutResult *)describeLayoutFromResponse:(zkElement *)dr {
 	zkElement *descResult = [dr childElement:@"result"];
-	ZKDescribeLayoutResult *desc = [[[ZKDescribeLayoutResult alloc] initWithXmlElement:descResult] autorelease];
+	ZKDescribeLayoutResult *layout = [[[ZKDescribeLayoutResult alloc] initWithXmlElement:descResult] autorelease];
+	if (detachDescribes) [layout detach];
+	return layout;
+}
+
+- (void)storeResponse:(zkElement *)response forKey:(NSString *)key {
+	ZKMetadataCache *cache = [self metadataCache];
+	if (cache == nil || response == nil) return;
+	[cache setXml:[response xmlData] forKey:key];
+}
+
+- (NSArray *)cachedDescribeGlobal {
+	zkElement *rr = [zkParser parseData:[[self metadataCache] xmlForKey:describeGlobalCacheKey()]];
+	if (rr == nil) return nil;
+	NSArray *results = [[rr childElement:@"result"] childElements:@"sobjects"];
+	NSMutableArray *types = [NSMutableArray arrayWithCapacity:[results count]];
+	for (zkElement *res in results) {
+		ZKDescribeGlobalSObject *d = [[ZKDescribeGlobalSObject alloc] initWithXmlElement:res];
+		if (detachDescribes) [d detach];
+		[types addObject:d];
+		[d release];
+	}
+	return types;
+}
+
+// describeSObject and describeSObjects both store just the result element, so either can answer.
+- (ZKDescribeSObject *)cachedDescribeSObject:(NSString *)sobjectName {
+	zkElement *descResult = [zkParser parseData:[[self metadataCache] xmlForKey:describeSObjectCacheKey(sobjectName)]];
+	if (descResult == nil) return nil;
+	ZKDescribeSObject *desc = [[[ZKDescribeSObject alloc] initWithXmlElement:descResult] autorelease];
+	if (detachDescribes) [desc detach];
 	return desc;
 }
 
+- (ZKDescribeLayoutResult *)cachedDescribeLayout:(NSString *)sobjectName {
+	zkElement *dr = [zkParser parseData:[[self metadataCache] xmlForKey:describeLayoutCacheKey(sobjectName)]];
+	return dr == nil ? nil : [self describeLayoutFromResponse:dr];
+}
+
 - (NSArray *)search:(NSString *)sosl {
 	if (!authSource) return NULL;
 	[self checkSession];
-	ZKEnvelope *env = [[ZKPartnerEnvelope alloc] initWithSessionHeader:[authSource sessionId] clientId:clientId];
+	return [self searchResultsFromResponse:[self sendRequestData:[self searchEnvelope:sosl] returnRoot:NO]];
+}
+
+- (NSData *)searchEnvelope:(NSString *)sosl {
+	ZKEnvelope *env = [[[ZKPartnerEnvelope alloc] initWithSessionHeader:[authSource sessionId] clientId:clientId] autorelease];
 	[env startElement:@"search"];
 	[env addElement:@"searchString" elemValue:sosl];
 	[env endElement:@"search"];
 	[env endElement:@"s:Body"];
-	
-	zkElement *sr = [self sendRequest:[env end]];
+	return [env endData];
+}
+
+- (NSArray *)searchResultsFromResponse:(zkElement *)sr {
 	zkElement *searchResult = [sr childElement:@"result"];
 	NSArray *records = [searchResult childElements:@"searchRecords"];
 	NSMutableArray *sobjects = [NSMutableArray arrayWithCapacity:[records count]];
 	for (zkElement *soNode in records)
 		[sobjects addObject:[ZKSObject fromXmlNode:[soNode childElement:@"record"]]];
-	[env release];
 	return sobjects;
 }
 
@@ -282,7 +501,7 @@ static const int SAVE_BATCH_SIZE = 25;
 	[env endElement:@"getServerTimestamp"];
 	[env endElement:@"s:Body"];
 	
-	zkElement *res = [self sendRequest:[env end]];
+	zkElement *res = [self sendRequestData:[env endData] returnRoot:NO];
 	zkElement *timestamp = [res childElement:@"result"];
 	[env release];
 	return [timestamp stringValue];
@@ -311,34 +530,48 @@ static const int SAVE_BATCH_SIZE = 25;
 - (NSArray *)sobjectsImpl:(NSArray *)objects name:(NSString *)elemName {
 	if(!authSource) return NULL;
 	[self checkSession];
-	
-	// if more than we can do in one go, break it up.
-	if ([objects count] > SAVE_BATCH_SIZE) {
-		NSMutableArray *allResults = [NSMutableArray arrayWithCapacity:[objects count]];
-		NSRange rng = {0, MIN(SAVE_BATCH_SIZE, [objects count])};
-		while (rng.location < [objects count]) {
-			[allResults addObjectsFromArray:[self sobjectsImpl:[objects subarrayWithRange:rng] name:elemName]];
-			rng.location += rng.length;
-			rng.length = MIN(SAVE_BATCH_SIZE, [objects count] - rng.location);
-		}
-		return allResults;
-	}
-	ZKEnvelope *env = [[ZKPartnerEnvelope alloc] initWithSessionAndMruHeaders:[authSource sessionId] mru:updateMru clientId:clientId];
+	return [self saveImpl:objects envelope:^NSData *(NSArray *batch) {
+		return [self sobjectsEnvelope:batch name:elemName];
+	}];
+}
+
+// runs the batched async version, and waits for it, so both split things up the same way.
+- (NSArray *)saveImpl:(NSArray *)items envelope:(NSData *(^)(NSArray *batch))envelopeBlock {
+	__block NSArray *results = nil;
+	__block NSException *error = nil;
+	dispatch_semaphore_t done = dispatch_semaphore_create(0);
+	[self performSave:items envelope:envelopeBlock queue:dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0) failBlock:^(NSException *ex) {
+		error = [ex retain];
+		dispatch_semaphore_signal(done);
+	} completeBlock:^(NSArray *r) {
+		results = [r retain];
+		dispatch_semaphore_signal(done);
+	}];
+	dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+	dispatch_release(done);
+	if (error != nil)
+		@throw [error autorelease];
+	return [results autorelease];
+}
+
+- (NSData *)sobjectsEnvelope:(NSArray *)objects name:(NSString *)elemName {
+	ZKEnvelope *env = [[[ZKPartnerEnvelope alloc] initWithSessionAndMruHeaders:[authSource sessionId] mru:updateMru clientId:clientId] autorelease];
 	[env startElement:elemName];
     for (ZKSObject *o in objects) 
 		[env addElement:@"sobject" elemValue:o];
 	[env endElement:elemName];
 	[env endElement:@"s:Body"];
+	return [env endData];
+}
 
-	zkElement *cr = [self sendRequest:[env end]];
+- (NSArray *)saveResultsFromResponse:(zkElement *)cr {
 	NSArray *resultsArr = [cr childElements:@"result"];
 	NSMutableArray *results = [NSMutableArray arrayWithCapacity:[resultsArr count]];
-	for (zkElement *cr in resultsArr) {
-		ZKSaveResult * sr = [[ZKSaveResult alloc] initWithXmlElement:cr];
+	for (zkElement *res in resultsArr) {
+		ZKSaveResult * sr = [[ZKSaveResult alloc] initWithXmlElement:res];
 		[results addObject:sr];
 		[sr release];
 	}
-	[env release];
 	return results;
 }
 
@@ -346,23 +579,44 @@ static const int SAVE_BATCH_SIZE = 25;
 	if(!authSource) return NULL;
 	[self checkSession];
 	
-	ZKEnvelope * env = [[ZKPartnerEnvelope alloc] initWithSessionHeader:[authSource sessionId] clientId:clientId];
+	__block NSDictionary *results = nil;
+	__block NSException *error = nil;
+	dispatch_semaphore_t done = dispatch_semaphore_create(0);
+	[self performRetrieve:fields sobject:sobjectType ids:ids queue:dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0) failBlock:^(NSException *ex) {
+		error = [ex retain];
+		dispatch_semaphore_signal(done);
+	} completeBlock:^(NSDictionary *r) {
+		results = [r retain];
+		dispatch_semaphore_signal(done);
+	}];
+	dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+	dispatch_release(done);
+	if (error != nil)
+		@throw [error autorelease];
+	return [results autorelease];
+}
+
+- (NSData *)retrieveEnvelope:(NSString *)fields sobject:(NSString *)sobjectType ids:(NSArray *)ids {
+	ZKEnvelope *env = [[[ZKPartnerEnvelope alloc] initWithSessionHeader:[authSource sessionId] clientId:clientId] autorelease];
 	[env startElement:@"retrieve"];
 	[env addElement:@"fieldList" elemValue:fields];
 	[env addElement:@"sObjectType" elemValue:sobjectType];
 	[env addElementArray:@"ids" elemValue:ids];
 	[env endElement:@"retrieve"];
 	[env endElement:@"s:Body"];
-	
-	zkElement *rr = [self sendRequest:[env end]];
-	NSMutableDictionary *sobjects = [NSMutableDictionary dictionary]; 
+	return [env endData];
+}
+
+// ids that don't exist (or that we can't see) come back as nil results, and are skipped.
+- (NSArray *)retrieveResultsFromResponse:(zkElement *)rr {
 	NSArray *results = [rr childElements:@"result"];
+	NSMutableArray *sobjects = [NSMutableArray arrayWithCapacity:[results count]];
 	for (zkElement *res in results) {
 		ZKSObject *o = [[ZKSObject alloc] initFromXmlNode:res];
-		[sobjects setObject:o forKey:[o id]];
+		if ([o id] != nil)
+			[sobjects addObject:o];
 		[o release];
 	}
-	[env release];
 	return sobjects;
 }
 
@@ -370,38 +624,504 @@ static const int SAVE_BATCH_SIZE = 25;
 	if(!authSource) return NULL;
 	[self checkSession];
 
-	ZKEnvelope *env = [[ZKPartnerEnvelope alloc] initWithSessionAndMruHeaders:[authSource sessionId] mru:updateMru clientId:clientId];
+	return [self saveImpl:ids envelope:^NSData *(NSArray *batch) {
+		return [self deleteEnvelope:batch];
+	}];
+}
+
+- (NSData *)deleteEnvelope:(NSArray *)ids {
+	ZKEnvelope *env = [[[ZKPartnerEnvelope alloc] initWithSessionAndMruHeaders:[authSource sessionId] mru:updateMru clientId:clientId] autorelease];
 	[env startElement:@"delete"];
 	[env addElement:@"ids" elemValue:ids];
 	[env endElement:@"delete"];
 	[env endElement:@"s:Body"];
-	
-	zkElement *cr = [self sendRequest:[env end]];
-	NSArray *resArr = [cr childElements:@"result"];
-	NSMutableArray *results = [NSMutableArray arrayWithCapacity:[resArr count]];
-	for (zkElement *cr in resArr) {
-		ZKSaveResult *sr = [[ZKSaveResult alloc] initWithXmlElement:cr];
-		[results addObject:sr];
-		[sr release];
-	}
-	[env release];
-	return results;
+	return [env endData];
 }
 
 - (ZKQueryResult *)queryImpl:(NSString *)value operation:(NSString *)operation name:(NSString *)elemName {
 	if(!authSource) return NULL;
 	[self checkSession];
 
-	ZKEnvelope *env = [[ZKPartnerEnvelope alloc] initWithSessionHeader:[authSource sessionId] clientId:clientId];
+	int batchSize = [self nextQueryBatchSize];
+	CFAbsoluteTime started = CFAbsoluteTimeGetCurrent();
+	NSUInteger bytes = 0;
+	ZKQueryResult *qr = [self queryResultFromResponse:[self sendRequestData:[self queryEnvelope:value operation:operation name:elemName batchSize:batchSize] returnRoot:NO responseLength:&bytes]];
+	[self recordQueryBatch:qr batchSize:batchSize bytes:bytes duration:CFAbsoluteTimeGetCurrent() - started];
+	return qr;
+}
+
+- (NSData *)queryEnvelope:(NSString *)value operation:(NSString *)operation name:(NSString *)elemName batchSize:(int)batchSize {
+	ZKEnvelope *env = [[[ZKPartnerEnvelope alloc] initWithSessionHeader:[authSource sessionId] clientId:clientId queryBatchSize:batchSize] autorelease];
 	[env startElement:operation];
 	[env addElement:elemName elemValue:value];
 	[env endElement:operation];
 	[env endElement:@"s:Body"];
-	
-	zkElement *qr = [self sendRequest:[env end]];
-	ZKQueryResult *result = [[ZKQueryResult alloc] initFromXmlNode:[[qr childElements] objectAtIndex:0]];
-	[env release];
-	return [result autorelease];
+	return [env endData];
+}
+
+- (ZKQueryResult *)queryResultFromResponse:(zkElement *)qr {
+	return [[[ZKQueryResult alloc] initFromXmlNode:[[qr childElements] objectAtIndex:0] decodeConcurrency:[self decodeConcurrency]] autorelease];
+}
+
+- (int)queryBatchSize {
+	return queryBatchSize;
+}
+
+- (void)setQueryBatchSize:(int)size {
+	@synchronized (self) {
+		queryBatchSize = size;
+		adaptiveBatchSize = size > 0 ? size : DEFAULT_ADAPTIVE_BATCH_SIZE;
+	}
+}
+
+- (BOOL)adaptiveQueryBatchSize {
+	return adaptiveQueryBatchSize;
+}
+
+- (void)setAdaptiveQueryBatchSize:(BOOL)adaptive {
+	@synchronized (self) {
+		adaptiveQueryBatchSize = adaptive;
+		adaptiveBatchSize = queryBatchSize > 0 ? queryBatchSize : DEFAULT_ADAPTIVE_BATCH_SIZE;
+	}
+}
+
+- (int)saveBatchSize {
+	return saveBatchSize;
+}
+
+- (void)setSaveBatchSize:(int)size {
+	@synchronized (self) {
+		saveBatchSize = MAX(1, MIN(MAX_SAVE_BATCH_SIZE, size));
+	}
+}
+
+- (int)saveConcurrency {
+	return saveConcurrency;
+}
+
+- (void)setSaveConcurrency:(int)concurrency {
+	@synchronized (self) {
+		saveConcurrency = MAX(1, concurrency);
+	}
+}
+
+- (int)retrieveConcurrency {
+	return retrieveConcurrency;
+}
+
+- (void)setRetrieveConcurrency:(int)concurrency {
+	@synchronized (self) {
+		retrieveConcurrency = MAX(1, concurrency);
+	}
+}
+
+- (int)decodeConcurrency {
+	return decodeConcurrency;
+}
+
+- (void)setDecodeConcurrency:(int)concurrency {
+	@synchronized (self) {
+		decodeConcurrency = MAX(1, concurrency);
+	}
+}
+
+- (int)nextQueryBatchSize {
+	@synchronized (self) {
+		return adaptiveQueryBatchSize ? adaptiveBatchSize : queryBatchSize;
+	}
+}
+
+// tunes the adaptive batch size from how the last batch went. Fewer, bigger batches
+// save round trips, but past a point each one takes long enough that the caller
+// sits waiting for it, and the response has to be held in memory while it's parsed.
+- (void)recordQueryBatch:(ZKQueryResult *)qr batchSize:(int)batchSize bytes:(NSUInteger)bytes duration:(NSTimeInterval)duration {
+	if (!adaptiveQueryBatchSize || qr == nil || batchSize <= 0 || duration <= 0) return;
+	int next = batchSize;
+	if (duration > QUERY_BATCH_TARGET_TIME * 1.5 || bytes > QUERY_BATCH_MAX_BYTES) {
+		// too slow or too big, scale back to what would have been on target.
+		double scale = MIN(QUERY_BATCH_TARGET_TIME / duration, (double)QUERY_BATCH_MAX_BYTES / MAX(bytes, 1));
+		next = (int)(batchSize * scale);
+	} else if (duration < QUERY_BATCH_TARGET_TIME / 2 && [qr count] >= (NSUInteger)batchSize && [qr queryLocator] != nil) {
+		// we got all we asked for quickly and there's more to come, the server can
+		// return fewer rows than asked for if they're wide, in which case bigger batches won't help.
+		next = batchSize * 2;
+	}
+	@synchronized (self) {
+		adaptiveBatchSize = MAX(MIN_QUERY_BATCH_SIZE, MIN(MAX_QUERY_BATCH_SIZE, next));
+	}
+}
+
+#pragma mark async calls
+
+- (ZKCancellationToken *)performRequest:(NSData *(^)(void))envelopeBlock decoder:(id (^)(zkElement *response))decoder failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(void (^)(id result))completeBlock {
+	return [self performRequest:envelopeBlock parser:nil token:nil queue:dispatch_get_main_queue() decoder:^id (zkElement *response, NSUInteger length) {
+		return decoder(response);
+	} failBlock:failBlock completeBlock:completeBlock];
+}
+
+// if there's a parser, the response is parsed as it arrives, otherwise once it's all been read.
+// if there's no token, a new one is made, either way the token for the call is returned.
+// the decoder also gets the (uncompressed) length of the response body.
+- (ZKCancellationToken *)performRequest:(NSData *(^)(void))envelopeBlock parser:(ZKPushParser *)parser token:(ZKCancellationToken *)token queue:(dispatch_queue_t)queue decoder:(id (^)(zkElement *response, NSUInteger length))decoder failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(void (^)(id result))completeBlock {
+	if (token == nil)
+		token = [ZKCancellationToken token];
+	// the blocks are only called on the queue, and only if we haven't been cancelled by then.
+	void (^fail)(NSException *) = ^(NSException *ex) {
+		dispatch_async(queue, ^(void) {
+			if (![token isCancelled])
+				failBlock(ex);
+		});
+	};
+	if (!authSource) {
+		dispatch_async(queue, ^(void) {
+			if (![token isCancelled])
+				completeBlock(nil);
+		});
+		return token;
+	}
+	// building the envelope may need to refresh the session, which blocks, so get off the callers thread first.
+	dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(void) {
+		if ([token isCancelled]) return;
+		NSData *env = nil;
+		CFAbsoluteTime started = CFAbsoluteTimeGetCurrent(), envelopeStarted = started;
+		@try {
+			[self checkSession];
+			envelopeStarted = CFAbsoluteTimeGetCurrent();
+			env = envelopeBlock();
+		} @catch (NSException *ex) {
+			fail(ex);
+			return;
+		}
+		NSString *op = [ZKOperationStats operationNameForEnvelopeData:env];
+		[stats recordPhase:ZKOperationPhaseEnvelope ofOperation:op duration:CFAbsoluteTimeGetCurrent() - envelopeStarted];
+		// the caller's token may well outlive this request (e.g. one shared by every batch of a call),
+		// so the handler that cancels the request is taken off it again once the request is finished with.
+		__block id cancelHandler = nil;
+		__block BOOL finished = NO;
+		void (^sendFinished)(void) = ^(void) {
+			@synchronized (token) {
+				finished = YES;
+				[token removeCancelHandler:cancelHandler];
+			}
+		};
+		void (^sendFailed)(NSException *) = ^(NSException *ex) {
+			sendFinished();
+			fail(ex);
+		};
+		void (^complete)(zkElement *, NSUInteger) = ^(zkElement *response, NSUInteger length) {
+			sendFinished();
+			if ([token isCancelled]) return;
+			id result = nil;
+			CFAbsoluteTime decodeStarted = CFAbsoluteTimeGetCurrent();
+			@try {
+				result = decoder(response, length);
+				// records decoded while the response was being parsed count as decode time too.
+				[stats recordPhase:ZKOperationPhaseDecode ofOperation:op duration:CFAbsoluteTimeGetCurrent() - decodeStarted + [parser elementBlockTime]];
+				[stats recordPhase:ZKOperationPhaseTotal ofOperation:op duration:CFAbsoluteTimeGetCurrent() - started];
+			} @catch (NSException *ex) {
+				fail(ex);
+				return;
+			}
+			dispatch_async(queue, ^(void) {
+				if (![token isCancelled])
+					completeBlock(result);
+			});
+		};
+		ZKCancellationToken *sent = nil;
+		if (parser != nil)
+			sent = [self sendRequestData:env parser:parser failBlock:sendFailed completeBlock:^(zkElement *response) {
+				complete(response, [parser bytesParsed]);
+			}];
+		else
+			sent = [self sendRequestData:env returnRoot:NO failBlock:sendFailed lengthBlock:complete];
+		@synchronized (token) {
+			if (!finished)
+				cancelHandler = [token addCancelHandler:^(void) {
+					[sent cancel];
+				}];
+		}
+	});
+	return token;
+}
+
+- (ZKCancellationToken *)performDescribeGlobalWithFailBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock {
+	NSArray *dg = [self cachedDescribeForKey:@"describe__global"];
+	if (dg != nil) {
+		ZKCancellationToken *token = [ZKCancellationToken token];
+		dispatch_async(dispatch_get_main_queue(), ^(void) {
+			if (![token isCancelled])
+				completeBlock(dg);
+		});
+		return token;
+	}
+	return [self performRequest:^NSData *(void) {
+		return [self describeGlobalEnvelope];
+	} decoder:^id (zkElement *response) {
+		[self storeResponse:response forKey:describeGlobalCacheKey()];
+		return [self describeGlobalFromResponse:response];
+	} failBlock:failBlock completeBlock:^(id result) {
+		completeBlock(result);
+	}];
+}
+
+- (ZKCancellationToken *)performDescribeSObject:(NSString *)sobjectName failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteDescribeSObjectBlock)completeBlock {
+	ZKDescribeSObject *desc = [self cachedDescribeForKey:[sobjectName lowercaseString]];
+	if (desc != nil) {
+		ZKCancellationToken *token = [ZKCancellationToken token];
+		dispatch_async(dispatch_get_main_queue(), ^(void) {
+			if (![token isCancelled])
+				completeBlock(desc);
+		});
+		return token;
+	}
+	return [self performRequest:^NSData *(void) {
+		return [self describeSObjectEnvelope:sobjectName];
+	} decoder:^id (zkElement *response) {
+		[self storeResponse:[response childElement:@"result"] forKey:describeSObjectCacheKey(sobjectName)];
+		return [self describeSObjectFromResponse:response name:sobjectName];
+	} failBlock:failBlock completeBlock:^(id result) {
+		completeBlock(result);
+	}];
+}
+
+- (ZKCancellationToken *)performDescribeSObjects:(NSArray *)sobjectNames failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock {
+	return [self performDescribeSObjects:sobjectNames queue:dispatch_get_main_queue() failBlock:failBlock completeBlock:completeBlock];
+}
+
+// asks for the ones that aren't already cached in DESCRIBE_SOBJECTS_BATCH_SIZE chunks, up to
+// retrieveConcurrency of them at once, then puts the results back in the order they were asked for.
+- (ZKCancellationToken *)performDescribeSObjects:(NSArray *)sobjectNames queue:(dispatch_queue_t)queue failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock {
+	NSMutableDictionary *found = [NSMutableDictionary dictionaryWithCapacity:[sobjectNames count]];
+	NSMutableArray *missing = [NSMutableArray arrayWithCapacity:[sobjectNames count]];
+	for (NSString *name in sobjectNames) {
+		NSString *key = [name lowercaseString];
+		ZKDescribeSObject *desc = [self cachedDescribeForKey:key];
+		if (desc != nil)
+			[found setObject:desc forKey:key];
+		else if (![missing containsObject:name])
+			[missing addObject:name];
+	}
+	ZKCancellationToken *token = [ZKCancellationToken token];
+	ZKBatchedCall *call = [[ZKBatchedCall alloc] initWithItems:missing batchSize:DESCRIBE_SOBJECTS_BATCH_SIZE concurrency:[self retrieveConcurrency] sendBlock:^(NSArray *batch, zkFailWithExceptionBlock batchFailed, zkCompleteArrayBlock batchDone) {
+		[self performRequest:^NSData *(void) {
+			return [self describeSObjectsEnvelope:batch];
+		} parser:nil token:token queue:dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0) decoder:^id (zkElement *response, NSUInteger length) {
+			return [self describeSObjectsFromResponse:response names:batch];
+		} failBlock:batchFailed completeBlock:^(id result) {
+			batchDone(result);
+		}];
+	}];
+	[call setFailOnAnyError:YES];
+	[call startWithToken:token queue:queue failBlock:failBlock completeBlock:^(NSArray *descs) {
+		// the batches are decoded in parallel, so they're added to the describe cache here, all at once.
+		NSUInteger i = 0;
+		for (ZKDescribeSObject *desc in descs) {
+			NSString *key = [[missing objectAtIndex:i++] lowercaseString];
+			[found setObject:desc forKey:key];
+			[self cacheDescribe:desc forKey:key];
+		}
+		NSMutableArray *results = [NSMutableArray arrayWithCapacity:[sobjectNames count]];
+		for (NSString *name in sobjectNames) {
+			ZKDescribeSObject *desc = [found objectForKey:[name lowercaseString]];
+			if (desc != nil)
+				[results addObject:desc];
+		}
+		completeBlock(results);
+	}];
+	[call release];
+	return token;
+}
+
+- (ZKCancellationToken *)performDescribeLayout:(NSString *)sobjectName recordTypeIds:(NSArray *)recordTypeIds failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteDescribeLayoutResultBlock)completeBlock {
+	return [self performRequest:^NSData *(void) {
+		return [self describeLayoutEnvelope:sobjectName recordTypeIds:recordTypeIds];
+	} decoder:^id (zkElement *response) {
+		if ([recordTypeIds count] == 0)
+			[self storeResponse:response forKey:describeLayoutCacheKey(sobjectName)];
+		return [self describeLayoutFromResponse:response];
+	} failBlock:failBlock completeBlock:^(id result) {
+		completeBlock(result);
+	}];
+}
+
+- (ZKCancellationToken *)performSearch:(NSString *)sosl failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock {
+	return [self performRequest:^NSData *(void) {
+		return [self searchEnvelope:sosl];
+	} decoder:^id (zkElement *response) {
+		return [self searchResultsFromResponse:response];
+	} failBlock:failBlock completeBlock:^(id result) {
+		completeBlock(result);
+	}];
+}
+
+- (ZKCancellationToken *)performQueryImpl:(NSString *)value operation:(NSString *)operation name:(NSString *)elemName columnar:(BOOL)columnar token:(ZKCancellationToken *)token queue:(dispatch_queue_t)queue failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteQueryResultBlock)completeBlock {
+	// records are decoded as they're read off the wire (Envelope/Body/queryResponse/result/records), and
+	// dropped from the document, so we never hold the whole response in memory. Unless the records
+	// can be decoded across several threads, in which case we wait for all of them, and split them up.
+	// A columnar batch is always streamed, it's cheap enough to build that splitting it up wouldn't help.
+	NSMutableArray *records = nil;
+	ZKPushParser *parser = nil;
+	ZKRecordBatch *batch = nil;
+	int threads = [self decodeConcurrency];
+	if (columnar) {
+		batch = [[[ZKRecordBatch alloc] init] autorelease];
+		parser = [[[ZKPushParser alloc] initWithStreamedElement:@"records" depth:5 block:^(zkElement *e) {
+			[batch addRecordFromXmlNode:e];
+		}] autorelease];
+	} else if (threads <= 1) {
+		records = [NSMutableArray array];
+		parser = [[[ZKPushParser alloc] initWithStreamedElement:@"records" depth:5 block:^(zkElement *e) {
+			ZKSObject *o = [ZKQueryResult recordFromXmlNode:e];
+			if (o != nil)
+				[records addObject:o];
+		}] autorelease];
+	}
+	__block int batchSize = 0;
+	__block CFAbsoluteTime started = 0;
+	return [self performRequest:^NSData *(void) {
+		batchSize = [self nextQueryBatchSize];
+		started = CFAbsoluteTimeGetCurrent();
+		return [self queryEnvelope:value operation:operation name:elemName batchSize:batchSize];
+	} parser:parser token:token queue:queue decoder:^id (zkElement *response, NSUInteger length) {
+		zkElement *result = [[response childElements] objectAtIndex:0];
+		ZKQueryResult *qr = batch;
+		if (batch != nil)
+			[batch finishFromXmlNode:result];
+		else if (parser == nil)
+			qr = [[[ZKQueryResult alloc] initFromXmlNode:result decodeConcurrency:threads] autorelease];
+		else
+			qr = [[[ZKQueryResult alloc] initFromXmlNode:result records:records] autorelease];
+		[self recordQueryBatch:qr batchSize:batchSize bytes:length duration:CFAbsoluteTimeGetCurrent() - started];
+		return qr;
+	} failBlock:failBlock completeBlock:^(id result) {
+		completeBlock(result);
+	}];
+}
+
+- (ZKCancellationToken *)performQuery:(NSString *)soql failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteQueryResultBlock)completeBlock {
+	return [self performQueryImpl:soql operation:@"query" name:@"queryString" columnar:NO token:nil queue:dispatch_get_main_queue() failBlock:failBlock completeBlock:completeBlock];
+}
+
+- (ZKCancellationToken *)performQueryAll:(NSString *)soql failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteQueryResultBlock)completeBlock {
+	return [self performQueryImpl:soql operation:@"queryAll" name:@"queryString" columnar:NO token:nil queue:dispatch_get_main_queue() failBlock:failBlock completeBlock:completeBlock];
+}
+
+- (ZKCancellationToken *)performQueryMore:(NSString *)queryLocator failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteQueryResultBlock)completeBlock {
+	return [self performQueryImpl:queryLocator operation:@"queryMore" name:@"queryLocator" columnar:NO token:nil queue:dispatch_get_main_queue() failBlock:failBlock completeBlock:completeBlock];
+}
+
+- (ZKCancellationToken *)performQueryMore:(NSString *)queryLocator token:(ZKCancellationToken *)token queue:(dispatch_queue_t)queue failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteQueryResultBlock)completeBlock {
+	return [self performQueryImpl:queryLocator operation:@"queryMore" name:@"queryLocator" columnar:NO token:token queue:queue failBlock:failBlock completeBlock:completeBlock];
+}
+
+// each query is a batch of its own, and they're all in flight at once, so a record that has to be read
+// with several queries (e.g. more fields than fit in one select) takes about as long as a single query.
+- (ZKCancellationToken *)performQueries:(NSArray *)soqls failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock {
+	// the queries get a token of their own, so that the first one to fail can cancel the rest without
+	// cancelling the call, which would stop it from reporting the failure. cancelling the call cancels them too.
+	ZKCancellationToken *token = [ZKCancellationToken token];
+	ZKCancellationToken *queries = [ZKCancellationToken token];
+	[token addCancelHandler:^(void) {
+		[queries cancel];
+	}];
+	ZKBatchedCall *call = [[ZKBatchedCall alloc] initWithItems:soqls batchSize:1 concurrency:MAX([soqls count], 1) sendBlock:^(NSArray *batch, zkFailWithExceptionBlock batchFailed, zkCompleteArrayBlock batchDone) {
+		// every query is already in flight, so failOnAnyError alone wouldn't stop the others.
+		zkFailWithExceptionBlock failed = ^(NSException *ex) {
+			[queries cancel];
+			batchFailed(ex);
+		};
+		[self performQueryImpl:[batch objectAtIndex:0] operation:@"query" name:@"queryString" columnar:NO token:queries queue:dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0) failBlock:failed completeBlock:^(ZKQueryResult *qr) {
+			// there's no result at all if we're not logged in any more.
+			if (qr == nil)
+				failed([NSException exceptionWithName:@"Not logged in" reason:@"The query couldn't be sent, the client isn't logged in" userInfo:nil]);
+			else
+				batchDone([NSArray arrayWithObject:qr]);
+		}];
+	}];
+	[call setFailOnAnyError:YES];
+	[call startWithToken:token queue:dispatch_get_main_queue() failBlock:failBlock completeBlock:completeBlock];
+	[call release];
+	return token;
+}
+
+- (ZKCancellationToken *)performRecordBatchQuery:(NSString *)soql failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteRecordBatchBlock)completeBlock {
+	return [self performQueryImpl:soql operation:@"query" name:@"queryString" columnar:YES token:nil queue:dispatch_get_main_queue() failBlock:failBlock completeBlock:^(ZKQueryResult *qr) {
+		completeBlock((ZKRecordBatch *)qr);
+	}];
+}
+
+- (ZKCancellationToken *)performRecordBatchQueryMore:(NSString *)queryLocator token:(ZKCancellationToken *)token queue:(dispatch_queue_t)queue failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteRecordBatchBlock)completeBlock {
+	return [self performQueryImpl:queryLocator operation:@"queryMore" name:@"queryLocator" columnar:YES token:token queue:queue failBlock:failBlock completeBlock:^(ZKQueryResult *qr) {
+		completeBlock((ZKRecordBatch *)qr);
+	}];
+}
+
+// sends the items saveBatchSize at a time, with up to saveConcurrency batches in flight.
+// every batch shares the one token, so cancelling it stops the whole lot.
+- (ZKCancellationToken *)performSave:(NSArray *)items envelope:(NSData *(^)(NSArray *batch))envelopeBlock queue:(dispatch_queue_t)queue failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock {
+	ZKCancellationToken *token = [ZKCancellationToken token];
+	int size, concurrency;
+	@synchronized (self) {
+		size = saveBatchSize;
+		concurrency = saveConcurrency;
+	}
+	ZKBatchedCall *call = [[ZKBatchedCall alloc] initWithItems:items batchSize:size concurrency:concurrency sendBlock:^(NSArray *batch, zkFailWithExceptionBlock batchFailed, zkCompleteArrayBlock batchDone) {
+		[self performRequest:^NSData *(void) {
+			return envelopeBlock(batch);
+		} parser:nil token:token queue:dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0) decoder:^id (zkElement *response, NSUInteger length) {
+			return [self saveResultsFromResponse:response];
+		} failBlock:batchFailed completeBlock:^(id result) {
+			batchDone(result);
+		}];
+	}];
+	[call startWithToken:token queue:queue failBlock:failBlock completeBlock:completeBlock];
+	[call release];
+	return token;
+}
+
+- (ZKCancellationToken *)performRetrieve:(NSString *)fields sobject:(NSString *)sobjectType ids:(NSArray *)ids failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteDictionaryBlock)completeBlock {
+	return [self performRetrieve:fields sobject:sobjectType ids:ids queue:dispatch_get_main_queue() failBlock:failBlock completeBlock:completeBlock];
+}
+
+// splits the ids into RETRIEVE_BATCH_SIZE chunks, fetches up to retrieveConcurrency of them at once, and merges the results.
+- (ZKCancellationToken *)performRetrieve:(NSString *)fields sobject:(NSString *)sobjectType ids:(NSArray *)ids queue:(dispatch_queue_t)queue failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteDictionaryBlock)completeBlock {
+	ZKCancellationToken *token = [ZKCancellationToken token];
+	ZKBatchedCall *call = [[ZKBatchedCall alloc] initWithItems:ids batchSize:RETRIEVE_BATCH_SIZE concurrency:[self retrieveConcurrency] sendBlock:^(NSArray *batch, zkFailWithExceptionBlock batchFailed, zkCompleteArrayBlock batchDone) {
+		[self performRequest:^NSData *(void) {
+			return [self retrieveEnvelope:fields sobject:sobjectType ids:batch];
+		} parser:nil token:token queue:dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0) decoder:^id (zkElement *response, NSUInteger length) {
+			return [self retrieveResultsFromResponse:response];
+		} failBlock:batchFailed completeBlock:^(id result) {
+			batchDone(result);
+		}];
+	}];
+	[call setFailOnAnyError:YES];
+	[call startWithToken:token queue:queue failBlock:failBlock completeBlock:^(NSArray *sobjects) {
+		NSMutableDictionary *results = [NSMutableDictionary dictionaryWithCapacity:[sobjects count]];
+		for (ZKSObject *o in sobjects)
+			[results setObject:o forKey:[o id]];
+		completeBlock(results);
+	}];
+	[call release];
+	return token;
+}
+
+- (ZKCancellationToken *)performCreate:(NSArray *)objects failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock {
+	return [self performSave:objects envelope:^NSData *(NSArray *batch) {
+		return [self sobjectsEnvelope:batch name:@"create"];
+	} queue:dispatch_get_main_queue() failBlock:failBlock completeBlock:completeBlock];
+}
+
+- (ZKCancellationToken *)performUpdate:(NSArray *)objects failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock {
+	return [self performSave:objects envelope:^NSData *(NSArray *batch) {
+		return [self sobjectsEnvelope:batch name:@"update"];
+	} queue:dispatch_get_main_queue() failBlock:failBlock completeBlock:completeBlock];
+}
+
+- (ZKCancellationToken *)performDelete:(NSArray *)ids failBlock:(zkFailWithExceptionBlock)failBlock completeBlock:(zkCompleteArrayBlock)completeBlock {
+	return [self performSave:ids envelope:^NSData *(NSArray *batch) {
+		return [self deleteEnvelope:batch];
+	} queue:dispatch_get_main_queue() failBlock:failBlock completeBlock:completeBlock];
 }
 
 @end
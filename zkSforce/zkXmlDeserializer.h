@@ -22,12 +22,35 @@
 
 @class zkElement;
 
+typedef enum {
+	zkXmlBoolean,
+	zkXmlInteger,
+	zkXmlString,
+	zkXmlSymbol		// a string from a small set of values (e.g. a field type), one copy of each value is shared by everyone.
+} ZKXmlValueType;
+
+typedef struct {
+	const char		*name;
+	ZKXmlValueType	type;
+} ZKXmlFieldDef;
+
+struct ZKXmlSchema;
+
 @interface ZKXmlDeserializer : NSObject {
 	zkElement *node;
 	NSMutableDictionary *values;
+	const struct ZKXmlSchema *schema;
 }
 - (id)initWithXmlElement:(zkElement *)e;
 
+// Subclasses can return a table of their simple typed elements, ending with
+// a NULL name, a subclass's table is added to its superclass's. These
+// elements are decoded in a single pass over the children when the object
+// is created, into storage that's allocated along with the object, rather
+// than being looked up in the DOM and memoized as they're asked for. The
+// default is NULL, elements that aren't in the table work as they always have.
++ (const ZKXmlFieldDef *)xmlSchema;
+
 - (NSString *)string:(NSString *)elem;
 - (BOOL)boolean:(NSString *)elem;
 - (int)integer:(NSString *)elem;
@@ -35,6 +58,15 @@
 - (NSArray *)strings:(NSString *)elem;
 
 - (NSString *)string:(NSString *)elemName fromXmlElement:(zkElement*)xmlElement;
+
+// Decodes the simple child elements that aren't in the schema table and
+// haven't been asked for yet, so string:, boolean:, integer: and double:
+// still work, then lets go of the XML element, so that the parsed document
+// can be freed once every object decoded from it has done the same. Repeated
+// and complex elements (strings:, complexTypeArrayFromElements:cls:) aren't
+// decoded here, after detach they're empty unless they were loaded first, so
+// subclasses with any of those load and detach them before calling super.
+- (void)detach;
 - (NSArray *)complexTypeArrayFromElements:(NSString *)elemName cls:(Class)type;
 
 @end
@@ -21,35 +21,212 @@
 
 #import "zkXmlDeserializer.h"
 #import "zkParser.h"
+#import <objc/runtime.h>
+#include <pthread.h>
+
+typedef struct {
+	ZKXmlValueType	type;
+	size_t			offset;		// from the start of the object's indexed ivars.
+} ZKXmlSlot;
+
+struct ZKXmlSchema {
+	size_t			size;
+	CFIndex			count;
+	ZKXmlSlot		*slots;
+	CFDictionaryRef	byUTF8Name;	// const char * -> slot index + 1
+	CFDictionaryRef	byName;		// NSString -> slot index + 1
+};
+
+static pthread_mutex_t schemaLock = PTHREAD_MUTEX_INITIALIZER;
+static CFMutableDictionaryRef schemas;	// Class -> struct ZKXmlSchema *, or kCFNull if it doesn't have one.
+
+static pthread_mutex_t symbolLock = PTHREAD_MUTEX_INITIALIZER;
+static CFMutableDictionaryRef symbols;	// const char * -> NSString
+
+static Boolean utf8Equal(const void *a, const void *b) {
+	return strcmp(a, b) == 0;
+}
+
+static CFHashCode utf8Hash(const void *a) {
+	CFHashCode h = 2166136261U;
+	for (const unsigned char *c = a; *c != 0; c++)
+		h = (h ^ *c) * 16777619U;
+	return h;
+}
+
+static const CFDictionaryKeyCallBacks utf8KeyCallbacks = { 0, NULL, NULL, NULL, utf8Equal, utf8Hash };
+
+static NSString *symbolWithUTF8String(const char *value) {
+	pthread_mutex_lock(&symbolLock);
+	if (symbols == NULL)
+		symbols = CFDictionaryCreateMutable(NULL, 0, &utf8KeyCallbacks, &kCFTypeDictionaryValueCallBacks);
+	NSString *s = (NSString *)CFDictionaryGetValue(symbols, value);
+	if (s == nil) {
+		s = [NSString stringWithUTF8String:value];
+		CFDictionarySetValue(symbols, strdup(value), s);
+	}
+	pthread_mutex_unlock(&symbolLock);
+	return s;
+}
+
+static size_t slotSize(ZKXmlValueType t) {
+	switch (t) {
+		case zkXmlBoolean: return sizeof(BOOL);
+		case zkXmlInteger: return sizeof(int);
+		default: return sizeof(id);
+	}
+}
+
+static struct ZKXmlSchema *compileSchema(Class cls) {
+	// collect the tables from us & our superclasses, a subclass that doesn't have its own inherits its parent's.
+	const ZKXmlFieldDef *tables[16];
+	int tableCount = 0;
+	for (Class c = cls; c != [ZKXmlDeserializer class] && tableCount < 16; c = class_getSuperclass(c)) {
+		const ZKXmlFieldDef *t = [c xmlSchema];
+		if (t != NULL && (tableCount == 0 || tables[tableCount-1] != t))
+			tables[tableCount++] = t;
+	}
+	if (tableCount == 0) return NULL;
+
+	CFIndex count = 0;
+	for (int i = 0; i < tableCount; i++)
+		for (const ZKXmlFieldDef *f = tables[i]; f->name != NULL; f++)
+			count++;
+
+	struct ZKXmlSchema *s = calloc(1, sizeof(struct ZKXmlSchema));
+	s->slots = calloc(count, sizeof(ZKXmlSlot));
+	CFMutableDictionaryRef byUTF8Name = CFDictionaryCreateMutable(NULL, count, &utf8KeyCallbacks, NULL);
+	CFMutableDictionaryRef byName = CFDictionaryCreateMutable(NULL, count, &kCFTypeDictionaryKeyCallBacks, NULL);
+	// lay the objects out first, then the ints, then the BOOLs, so everything is aligned without padding.
+	ZKXmlValueType order[] = { zkXmlString, zkXmlInteger, zkXmlBoolean };
+	for (int o = 0; o < 3; o++) {
+		for (int i = 0; i < tableCount; i++) {
+			for (const ZKXmlFieldDef *f = tables[i]; f->name != NULL; f++) {
+				ZKXmlValueType t = f->type == zkXmlSymbol ? zkXmlString : f->type;
+				if (t != order[o] || CFDictionaryContainsKey(byUTF8Name, f->name)) continue;
+				s->slots[s->count].type = f->type;
+				s->slots[s->count].offset = s->size;
+				s->size += slotSize(f->type);
+				s->count++;
+				CFDictionarySetValue(byUTF8Name, f->name, (const void *)s->count);
+				NSString *name = [[NSString alloc] initWithUTF8String:f->name];
+				CFDictionarySetValue(byName, name, (const void *)s->count);
+				[name release];
+			}
+		}
+	}
+	s->byUTF8Name = byUTF8Name;
+	s->byName = byName;
+	return s;
+}
+
+static const struct ZKXmlSchema *schemaForClass(Class cls) {
+	pthread_mutex_lock(&schemaLock);
+	if (schemas == NULL)
+		schemas = CFDictionaryCreateMutable(NULL, 0, NULL, NULL);
+	const void *s = CFDictionaryGetValue(schemas, cls);
+	if (s == NULL) {
+		s = compileSchema(cls);
+		CFDictionarySetValue(schemas, cls, s == NULL ? kCFNull : s);
+	}
+	pthread_mutex_unlock(&schemaLock);
+	return s == kCFNull ? NULL : s;
+}
 
 @implementation ZKXmlDeserializer
 
++ (const ZKXmlFieldDef *)xmlSchema {
+	return NULL;
+}
+
+// the decoded values live in extra bytes at the end of the object, so there's no separate allocation for them.
++ (id)allocWithZone:(NSZone *)zone {
+	const struct ZKXmlSchema *s = schemaForClass(self);
+	ZKXmlDeserializer *d = NSAllocateObject(self, s == NULL ? 0 : s->size, zone);
+	d->schema = s;
+	return d;
+}
+
+- (void)decodeSchema {
+	char *base = object_getIndexedIvars(self);
+	const struct ZKXmlSchema *s = schema;
+	[node enumerateChildValuesUsingBlock:^(const char *name, const char *value) {
+		CFIndex idx = (CFIndex)CFDictionaryGetValue(s->byUTF8Name, name);
+		if (idx == 0 || value == NULL) return;
+		const ZKXmlSlot *slot = &s->slots[idx-1];
+		void *p = base + slot->offset;
+		switch (slot->type) {
+			case zkXmlBoolean:
+				*(BOOL *)p = strcmp(value, "true") == 0;
+				break;
+			case zkXmlInteger:
+				*(int *)p = atoi(value);
+				break;
+			case zkXmlString:
+				// if an element is repeated the first one wins, same as childElement:
+				if (*(id *)p == nil)
+					*(id *)p = [[NSString alloc] initWithUTF8String:value];
+				break;
+			case zkXmlSymbol:
+				if (*(id *)p == nil)
+					*(id *)p = [symbolWithUTF8String(value) retain];
+				break;
+		}
+	}];
+}
+
 -(id)initWithXmlElement:(zkElement *)e {
 	self = [super init];
 	node = [e retain];
-	values = [[NSMutableDictionary alloc] init];
+	if (schema != NULL && node != nil)
+		[self decodeSchema];
 	return self;
 }
 
 -(void)dealloc {
+	if (schema != NULL) {
+		char *base = object_getIndexedIvars(self);
+		for (CFIndex i = 0; i < schema->count; i++) {
+			if (schema->slots[i].type == zkXmlString || schema->slots[i].type == zkXmlSymbol)
+				[*(id *)(base + schema->slots[i].offset) release];
+		}
+	}
 	[node release];
 	[values release];
 	[super dealloc];
 }
 
+// the decoded value of elem, if it's in the schema as this type, otherwise NULL.
+- (void *)slotNamed:(NSString *)elem type:(ZKXmlValueType)type {
+	if (schema == NULL) return NULL;
+	CFIndex idx = (CFIndex)CFDictionaryGetValue(schema->byName, elem);
+	if (idx == 0) return NULL;
+	const ZKXmlSlot *slot = &schema->slots[idx-1];
+	ZKXmlValueType st = slot->type == zkXmlSymbol ? zkXmlString : slot->type;
+	if (st != type) return NULL;
+	return (char *)object_getIndexedIvars(self) + slot->offset;
+}
+
 - (NSString *)string:(NSString *)elem {
+	id *slot = [self slotNamed:elem type:zkXmlString];
+	if (slot != NULL) return *slot;
 	id cached = [values objectForKey:elem];
 	if (cached != nil) return cached == [NSNull null] ? nil : cached;
 	id v = [self string:elem fromXmlElement:node];
+	if (values == nil) values = [[NSMutableDictionary alloc] init];
 	[values setObject:(v != nil ? v : [NSNull null]) forKey:elem];
 	return v;
 }
 
 - (BOOL)boolean:(NSString *)elem {
+	BOOL *slot = [self slotNamed:elem type:zkXmlBoolean];
+	if (slot != NULL) return *slot;
 	return [[self string:elem] isEqualToString:@"true"];
 }
 
 - (int)integer:(NSString *)elem {
+	int *slot = [self slotNamed:elem type:zkXmlInteger];
+	if (slot != NULL) return *slot;
 	return [[self string:elem] intValue];
 }
 
@@ -65,6 +242,7 @@
 	for (zkElement *e in nodes) 
 		[s addObject:[e stringValue]];
 	
+	if (values == nil) values = [[NSMutableDictionary alloc] init];
 	[values setObject:s forKey:elem];
 	return s;
 }
@@ -73,6 +251,27 @@
 	return [[xmlElement childElement:elemName] stringValue];
 }
 
+- (void)detach {
+	// the values that aren't in the schema table are only ever read from the DOM, so decode
+	// them now, or string:, boolean: and integer: would all come back empty afterwards.
+	const struct ZKXmlSchema *s = schema;
+	[node enumerateChildValuesUsingBlock:^(const char *name, const char *value) {
+		if (value == NULL) return;
+		if (s != NULL && CFDictionaryContainsKey(s->byUTF8Name, name)) return;
+		NSString *key = [[NSString alloc] initWithUTF8String:name];
+		if (values == nil) values = [[NSMutableDictionary alloc] init];
+		// if an element is repeated the first one wins, same as childElement:
+		if ([values objectForKey:key] == nil) {
+			NSString *v = [[NSString alloc] initWithUTF8String:value];
+			[values setObject:v forKey:key];
+			[v release];
+		}
+		[key release];
+	}];
+	[node release];
+	node = nil;
+}
+
 - (NSArray *)complexTypeArrayFromElements:(NSString *)elemName cls:(Class)type {
 	NSArray *cached = [values objectForKey:elemName];
 	if (cached == nil) {
@@ -83,6 +282,7 @@
 			[results addObject:child];
 			[child release];
 		}
+		if (values == nil) values = [[NSMutableDictionary alloc] init];
 		[values setObject:results forKey:elemName];
 		cached = results;
 	}